@@ -3,7 +3,8 @@
  *  render.cpp
  *
  *  This example sends "Hello World !" when it starts and decodes it at the same
- *  time.
+ *  time. The callbacks are stamped with the time and the Bela frame counter,
+ *  and the latencies are reported when the program stops, see eventlog.c.
  *
  *  For full information on usage and licensing, see https://chirp.io/
  *
@@ -15,10 +16,17 @@
 #include <Bela.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <string>
 
 #include "credentials.h"
 #include "chirp_sdk.h"
+#include "eventlog.h"
+
+/*
+ * Blocks in the circular buffers.
+ */
+#define BUFFER_BLOCKS 8
 
 /*
  * Mirrors the block size set in the Bela config.
@@ -31,6 +39,20 @@ static uint8_t block_size = 0;
  */
 static uint32_t buffer_size = 0;
 
+/*
+ * Value of the Bela frame counter when each block of the input buffer was
+ * recorded, and when each block of the output buffer was last played.
+ */
+static uint64_t input_frames[BUFFER_BLOCKS];
+static uint64_t output_frames[BUFFER_BLOCKS];
+
+/*
+ * Frame of the block the SDK is processing, given to the event log. Both
+ * auxiliary tasks have the same priority and the BeagleBone a single core,
+ * so neither interrupts the other while in the SDK.
+ */
+static uint32_t stream_position = 0;
+
 /*
  * Global buffer used to store incoming audio data before
  * it is being processed in a lower priority task.
@@ -63,21 +85,45 @@ static AuxiliaryTask chirp_auxiliary_input_task = NULL;
  */
 static AuxiliaryTask chirp_auxiliary_output_task = NULL;
 
+uint32_t event_micros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (now.tv_sec * 1000000ull + now.tv_nsec / 1000);
+}
+
+uint32_t event_position(void)
+{
+    return stream_position;
+}
+
+static const eventlog_clock_t event_clock = { event_micros, event_position };
+
 void chirp_process_input_audio(void* data)
 {
     static int read_pointer = 0;
     chirp_sdk_t *chirp = (chirp_sdk_t *) data;
+    stream_position = (uint32_t) input_frames[read_pointer / block_size];
     if (chirp_sdk_process_input(chirp, &input_buffer[read_pointer], block_size) != CHIRP_SDK_OK)
     {
         rt_printf("Process decoding error\n");
     }
     read_pointer = (read_pointer + block_size) % buffer_size;
+
+    /*
+     * Print the events of both tasks.
+     */
+    eventlog_process();
 }
 
 void chirp_process_output_audio(void* data)
 {
     static int write_pointer = 0;
     chirp_sdk_t *chirp = (chirp_sdk_t *) data;
+    /*
+     * This block is played once the whole buffer has been played again.
+     */
+    stream_position = (uint32_t) (output_frames[write_pointer / block_size] + buffer_size);
     if (chirp_sdk_process_output(chirp, &output_buffer[write_pointer], block_size) != CHIRP_SDK_OK)
     {
         rt_printf("Process encoding error\n");
@@ -87,6 +133,7 @@ void chirp_process_output_audio(void* data)
 
 void on_received_callback(void *ptr, uint8_t *payload, size_t length, uint8_t channel)
 {
+    eventlog_payload(EVENTLOG_RECEIVED, payload, length, channel);
     if (payload)
     {
         char *msg = (char *) calloc(length + 1, sizeof(char));
@@ -103,21 +150,25 @@ void on_received_callback(void *ptr, uint8_t *payload, size_t length, uint8_t ch
 
 void on_state_changed_callback(void *ptr, chirp_sdk_state_t old_state, chirp_sdk_state_t new_state)
 {
+    eventlog_state(old_state, new_state);
     rt_printf("State changed\n");
 }
 
 void on_receiving_callback(void *ptr, uint8_t *payload, size_t length, uint8_t channel)
 {
+    eventlog_payload(EVENTLOG_RECEIVING, payload, length, channel);
     rt_printf("Receiving data\n");
 }
 
 void on_sent_callback(void *ptr, uint8_t *payload, size_t length, uint8_t channel)
 {
+    eventlog_payload(EVENTLOG_SENT, payload, length, channel);
     rt_printf("Data sent\n");
 }
 
 void on_sending_callback(void *ptr, uint8_t *payload, size_t length, uint8_t channel)
 {
+    eventlog_payload(EVENTLOG_SENDING, payload, length, channel);
     rt_printf("Sending data\n");
 }
 
@@ -128,7 +179,7 @@ bool setup(BelaContext *context, void *userData)
      */
     input_channel = 0;
     block_size = context->audioFrames;
-    buffer_size = block_size * 8;
+    buffer_size = block_size * BUFFER_BLOCKS;
     input_buffer = (float*) calloc(buffer_size, sizeof(float));
     output_buffer = (float*) calloc(buffer_size, sizeof(float));
 
@@ -163,6 +214,8 @@ bool setup(BelaContext *context, void *userData)
         rt_printf("Chirp error : %s\n", chirp_sdk_error_code_to_string(ret));
     }
 
+    eventlog_init(chirp, &event_clock, context->audioSampleRate);
+
     /*
      * Tell the SDK it can decode what it sends.
      */
@@ -236,6 +289,9 @@ void render(BelaContext *context, void *userData)
         rt_printf("Task scheduling for output failed\n");
     }
 
+    input_frames[write_pointer / block_size] = context->audioFramesElapsed;
+    output_frames[read_pointer / block_size] = context->audioFramesElapsed;
+
     for(unsigned int n = 0; n < context->audioFrames; n++)
     {
         input_buffer[write_pointer + n] = context->audioIn[n * context->audioInChannels + input_channel];
@@ -257,6 +313,9 @@ void render(BelaContext *context, void *userData)
 
 void cleanup(BelaContext *context, void *userData)
 {
+    eventlog_process();
+    eventlog_report();
+
     chirp_sdk_error_code_t ret = del_chirp_sdk(&chirp);
     if (ret != CHIRP_SDK_OK)
     {
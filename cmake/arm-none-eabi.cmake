@@ -0,0 +1,25 @@
+# Common part of the bare metal toolchains, included by the cortex-m4 and
+# cortex-m7 ones once they have set CHIRP_CPU_FLAGS.
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR arm)
+
+set(CMAKE_C_COMPILER arm-none-eabi-gcc)
+set(CMAKE_CXX_COMPILER arm-none-eabi-g++)
+set(CMAKE_ASM_COMPILER arm-none-eabi-gcc)
+set(CMAKE_OBJCOPY arm-none-eabi-objcopy CACHE FILEPATH "")
+set(CMAKE_SIZE arm-none-eabi-size CACHE FILEPATH "")
+set(CMAKE_OBJDUMP arm-none-eabi-objdump CACHE FILEPATH "")
+
+# There is no C library to link a test program against before the linker
+# script is known.
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(CMAKE_C_FLAGS_INIT "${CHIRP_CPU_FLAGS}")
+set(CMAKE_CXX_FLAGS_INIT "${CHIRP_CPU_FLAGS}")
+set(CMAKE_ASM_FLAGS_INIT "${CHIRP_CPU_FLAGS}")
+set(CMAKE_EXE_LINKER_FLAGS_INIT "--specs=nano.specs")
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
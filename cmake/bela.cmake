@@ -0,0 +1,21 @@
+# Bela, a BeagleBone Black running Linux with the Xenomai real-time kernel.
+# BELA_SYSROOT can point at a copy of the board root file system, needed to
+# find the Bela and Xenomai libraries when cross compiling.
+
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR armv7l)
+
+set(CMAKE_C_COMPILER arm-linux-gnueabihf-gcc)
+set(CMAKE_CXX_COMPILER arm-linux-gnueabihf-g++)
+
+set(CHIRP_CPU_FLAGS "-march=armv7-a -mtune=cortex-a8 -mfloat-abi=hard -mfpu=neon")
+set(CMAKE_C_FLAGS_INIT "${CHIRP_CPU_FLAGS}")
+set(CMAKE_CXX_FLAGS_INIT "${CHIRP_CPU_FLAGS}")
+
+if(DEFINED ENV{BELA_SYSROOT})
+	set(CMAKE_SYSROOT $ENV{BELA_SYSROOT})
+endif()
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
@@ -0,0 +1,3 @@
+# STM32F469I-DISCOVERY, single precision FPU.
+set(CHIRP_CPU_FLAGS "-mthumb -mcpu=cortex-m4 -mfloat-abi=hard -mfpu=fpv4-sp-d16")
+include(${CMAKE_CURRENT_LIST_DIR}/arm-none-eabi.cmake)
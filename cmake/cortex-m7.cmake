@@ -0,0 +1,3 @@
+# STM32F746G-DISCOVERY, single precision FPU.
+set(CHIRP_CPU_FLAGS "-mthumb -mcpu=cortex-m7 -mfloat-abi=hard -mfpu=fpv5-sp-d16")
+include(${CMAKE_CURRENT_LIST_DIR}/arm-none-eabi.cmake)
@@ -0,0 +1,50 @@
+# Options shared by the STM32 boards, matching their Makefiles.
+
+# Compile and link `target` with the profile flags and `ldscript`, then write
+# the .hex and .bin images next to the .elf and print its size. The .bin only
+# holds the internal flash. `placement` lists where the symbols were placed.
+function(chirp_firmware target ldscript)
+	target_compile_options(${target} PRIVATE
+		${CHIRP_OPT_FLAGS}
+		-Wall
+		-fmessage-length=0
+		-fsigned-char
+		-ffunction-sections
+		-fdata-sections
+		$<$<COMPILE_LANGUAGE:CXX>:-fno-exceptions -fno-rtti -fno-threadsafe-statics>)
+
+	target_link_options(${target} PRIVATE
+		${CHIRP_OPT_FLAGS}
+		-T${ldscript}
+		-Wl,--gc-sections
+		-Wl,--print-memory-usage
+		-Wl,-Map,${target}.map
+		-u _printf_float)
+
+	set_target_properties(${target} PROPERTIES
+		SUFFIX .elf
+		CXX_STANDARD 17
+		CXX_STANDARD_REQUIRED ON)
+
+	add_custom_command(TARGET ${target} POST_BUILD
+		COMMAND ${CMAKE_OBJCOPY} -O ihex $<TARGET_FILE:${target}> ${target}.hex
+		COMMAND ${CMAKE_OBJCOPY} -O binary -R .qspi_text -R .qspi_rodata $<TARGET_FILE:${target}> ${target}.bin
+		COMMAND ${CMAKE_SIZE} $<TARGET_FILE:${target}>)
+
+	find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+	add_custom_target(placement
+		COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/tools/placement_report.py
+			--objdump ${CMAKE_OBJDUMP} $<TARGET_FILE:${target}>
+		DEPENDS ${target})
+endfunction()
+
+# Regenerate the pre-rendered screens of the board whenever the generator or
+# the font of their banner changes, as the Makefiles do.
+function(chirp_screen_data output width height font)
+	find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+	add_custom_command(OUTPUT ${output}
+		COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/tools/make_screens.py ${width} ${height} ${font} > ${output}
+		DEPENDS ${CMAKE_SOURCE_DIR}/tools/make_screens.py ${font})
+endfunction()
@@ -0,0 +1,19 @@
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * State of an IMA ADPCM encoder or decoder, both start from zero.
+ */
+typedef struct {
+	int16_t predicted;
+	uint8_t index;
+} adpcm_state_t;
+
+size_t adpcm_encode(adpcm_state_t *state, const int16_t *samples, size_t stride, size_t count, uint8_t *output);
+
+size_t adpcm_decode(adpcm_state_t *state, const uint8_t *input, size_t count, int16_t *samples);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Size of the arena backing malloc(), placed in the `.arena` linker section.
+ * Can be overridden from the Makefile.
+ */
+#ifndef ARENA_SIZE
+#define ARENA_SIZE	(160 * 1024)
+#endif
+
+typedef struct {
+	size_t size;		// Size of the arena.
+	size_t used;		// Bytes currently allocated, headers included.
+	size_t peak;		// Highest value of `used` since boot.
+	size_t largest_free;	// Largest block that can currently be allocated.
+	size_t allocations;	// Blocks currently allocated.
+	size_t failures;	// Allocations that could not be satisfied.
+} arena_stats_t;
+
+void *arena_alloc(size_t size);
+
+void arena_free(void *pointer);
+
+void *arena_realloc(void *pointer, size_t size);
+
+void arena_get_stats(arena_stats_t *stats);
+
+#endif
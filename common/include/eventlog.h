@@ -0,0 +1,67 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chirp_sdk.h"
+
+/*
+ * Set to 1 by `make EVENT_LOG=1` for the boards to time stamp the callbacks
+ * of the SDK and report the latencies, see eventlog.c. The host simulation
+ * and the Bela example do not need it.
+ */
+#ifndef EVENT_LOG
+#define EVENT_LOG	0
+#endif
+
+/*
+ * Events waiting to be printed. Events recorded while it is full are
+ * dropped and counted. Can be overridden from the Makefile.
+ */
+#ifndef EVENTLOG_SIZE
+#define EVENTLOG_SIZE	32
+#endif
+
+// Seconds between two reports of the latencies.
+#define EVENTLOG_REPORT_SECONDS	60
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	EVENTLOG_STATE,
+	EVENTLOG_SENDING,
+	EVENTLOG_SENT,
+	EVENTLOG_RECEIVING,
+	EVENTLOG_RECEIVED,
+} eventlog_type_t;
+
+/*
+ * The clocks of the board. `micros` is a free-running 32 bits timer counting
+ * microseconds, wrapping every 71 minutes. `position` is the position in the
+ * audio of the block the SDK is processing, in samples at the sample rate of
+ * the SDK, as `pipeline_position()` returns it.
+ */
+typedef struct {
+	uint32_t (*micros)(void);
+	uint32_t (*position)(void);
+} eventlog_clock_t;
+
+void eventlog_init(chirp_sdk_t *sdk, const eventlog_clock_t *clock, uint32_t sample_rate);
+
+void eventlog_state(chirp_sdk_state_t old_state, chirp_sdk_state_t new_state);
+
+void eventlog_payload(eventlog_type_t type, const uint8_t *payload, size_t length, uint8_t channel);
+
+void eventlog_process(void);
+
+void eventlog_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef FIELDLOG_H
+#define FIELDLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "logstore.h"
+#include "pipeline.h"
+
+/*
+ * Number of the most recent audio periods kept in the log when a decode
+ * fails, limited to what fits in a sector. Can be overridden from the
+ * Makefile.
+ */
+#ifndef FIELDLOG_AUDIO_PERIODS
+#define FIELDLOG_AUDIO_PERIODS	8
+#endif
+
+typedef enum {
+	FIELDLOG_BOOT = 1,
+	FIELDLOG_DECODE,
+	FIELDLOG_AUDIO,
+} fieldlog_type_t;
+
+// Logged at every start.
+typedef struct {
+	uint32_t sample_rate;
+	uint16_t period_length;
+	uint16_t channels;
+} fieldlog_boot_t;
+
+// Logged at every decode, successful or not.
+typedef struct {
+	uint32_t received;		// Payloads decoded since the start.
+	uint32_t failed;		// Decodes failed since the start.
+	uint32_t period;		// Periods recorded since the start.
+	uint32_t length;		// Length of the payload, 0 if the decode failed.
+} fieldlog_decode_t;
+
+// Followed by the IMA ADPCM of the left channel, see adpcm.c.
+typedef struct {
+	uint32_t first;			// First period, counted as `period` above.
+	uint16_t periods;
+	uint16_t period_length;
+	uint32_t sample_rate;
+} fieldlog_audio_t;
+
+typedef struct {
+	const logstore_flash_t *flash;
+	uint32_t sample_rate;
+	// Periods recorded since the start and replay of the ones still in the
+	// history, see capture.h. No audio is logged if NULL.
+	uint32_t (*recorded_count)(void);
+	uint32_t (*replay)(uint32_t first, uint32_t count, pipeline_period_t callback);
+} fieldlog_config_t;
+
+bool fieldlog_init(const fieldlog_config_t *config);
+
+void fieldlog_decode(const uint8_t *payload, size_t length);
+
+void fieldlog_process(void);
+
+void fieldlog_print(void);
+
+void fieldlog_dump(void);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bytes of records waiting to be written to the flash. Records appended while
+ * it is full are dropped. Can be overridden from the Makefile.
+ */
+#ifndef LOGSTORE_QUEUE_SIZE
+#define LOGSTORE_QUEUE_SIZE		(8 * 1024)
+#endif
+
+// Largest page programmed at once.
+#define LOGSTORE_PAGE_SIZE		256
+
+// Bytes of header in front of every sector and every record.
+#define LOGSTORE_HEADER_SIZE	16
+
+/*
+ * The flash backing the store, which can only be erased by the sector and
+ * programmed by the page. `erase` and `program` start the operation and
+ * return, `busy` tells whether it is still running. `read` is only called
+ * while the flash is not busy.
+ */
+typedef struct {
+	// Offset of the store in the flash and its size, whole sectors.
+	uint32_t address;
+	uint32_t size;
+	uint32_t sector_size;
+	uint32_t page_size;
+	bool (*read)(uint32_t address, void *data, size_t size);
+	bool (*program)(uint32_t address, const void *data, size_t size);
+	bool (*erase)(uint32_t address);
+	bool (*busy)(void);
+	// Milliseconds since the start, stamped on every record.
+	uint32_t (*time)(void);
+} logstore_flash_t;
+
+/*
+ * A record found in the flash, whose data is read with `logstore_read()`.
+ */
+typedef struct {
+	uint32_t sequence;
+	uint32_t time;
+	uint8_t type;
+	uint16_t length;
+	uint32_t address;
+} logstore_record_t;
+
+// Returns false to stop the iteration.
+typedef bool (*logstore_callback_t)(const logstore_record_t *record, void *context);
+
+typedef struct {
+	uint32_t records;		// Records in the flash, the oldest ones are erased first.
+	uint32_t first;			// Sequence of the oldest record in the flash.
+	uint32_t next;			// Sequence of the next record appended.
+	uint32_t sectors;		// Sectors of the store holding records.
+	uint32_t sector_count;	// Sectors of the store.
+	uint32_t erases;		// Highest erase count of a sector.
+	uint32_t queued;		// Bytes waiting to be written.
+	uint32_t dropped;		// Records dropped because the queue was full.
+	uint32_t errors;		// Flash operations which failed.
+} logstore_stats_t;
+
+bool logstore_mount(const logstore_flash_t *flash);
+
+bool logstore_begin(uint8_t type, size_t length);
+
+void logstore_write(const void *data, size_t length);
+
+void logstore_end(void);
+
+bool logstore_append(uint8_t type, const void *data, size_t length);
+
+void logstore_process(void);
+
+void logstore_flush(void);
+
+void logstore_iterate(logstore_callback_t callback, void *context);
+
+bool logstore_read(const logstore_record_t *record, uint32_t offset, void *data, size_t size);
+
+void logstore_get_stats(logstore_stats_t *stats);
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Board specific settings of the pipeline: the shape of the audio periods
+ * and where its code is placed. Every board, and the host, provides its own
+ * in its include folder. The pipeline is specialised for them at compile
+ * time, see pipeline.hpp.
+ */
+#include "pipeline_conf.h"
+
+#ifndef PIPELINE_TEXT
+#define PIPELINE_TEXT
+#endif
+
+#ifndef PIPELINE_BSS
+#define PIPELINE_BSS
+#endif
+
+// Frames of a period in the DMA buffers.
+#ifndef PIPELINE_PERIOD_LENGTH
+#error "PIPELINE_PERIOD_LENGTH must be defined in pipeline_conf.h"
+#endif
+
+// Samples per frame in the DMA buffers, and the one decoded.
+#ifndef PIPELINE_CHANNELS
+#define PIPELINE_CHANNELS		2
+#endif
+
+#ifndef PIPELINE_RECORD_CHANNEL
+#define PIPELINE_RECORD_CHANNEL	0
+#endif
+
+// Frames averaged into each sample given to the SDK, which then runs at the
+// sample rate of the codec divided by this.
+#ifndef PIPELINE_DECIMATION
+#define PIPELINE_DECIMATION		1
+#endif
+
+/*
+ * Set to 1 to decode the delay-and-sum of the first two channels rather than
+ * `PIPELINE_RECORD_CHANNEL` alone. The delay between them is tracked within
+ * `PIPELINE_MAX_DELAY` frames either way.
+ */
+#ifndef PIPELINE_BEAMFORMING
+#define PIPELINE_BEAMFORMING	0
+#endif
+
+#ifndef PIPELINE_MAX_DELAY
+#define PIPELINE_MAX_DELAY		4
+#endif
+
+/*
+ * Set to 1 to band-pass the decoded audio to the band of the protocol and
+ * level it with an automatic gain control, see `Preprocessor`.
+ */
+#ifndef PIPELINE_PREPROCESS
+#define PIPELINE_PREPROCESS		0
+#endif
+
+/*
+ * Set to 1 to skip the SDK while the band of the protocol is silent, see
+ * `Gate`. The last `PIPELINE_GATE_PREROLL` periods skipped are decoded when
+ * the gate opens. Relies on the band-pass of the preprocessing.
+ */
+#ifndef PIPELINE_GATE
+#define PIPELINE_GATE			0
+#endif
+
+#ifndef PIPELINE_GATE_PREROLL
+#define PIPELINE_GATE_PREROLL	8
+#endif
+
+#if PIPELINE_GATE && !PIPELINE_PREPROCESS
+#error "PIPELINE_GATE requires PIPELINE_PREPROCESS"
+#endif
+
+// Length of the float buffer given to `loop`.
+#define PIPELINE_FLOAT_LENGTH	(PIPELINE_PERIOD_LENGTH / PIPELINE_DECIMATION)
+
+// Length of the record and play buffers, two periods each.
+#define PIPELINE_BUFFER_LENGTH	(2 * PIPELINE_PERIOD_LENGTH * PIPELINE_CHANNELS)
+
+/*
+ * Most periods replayed from the recorded history to catch up with the
+ * audio. Can be overridden in pipeline_conf.h.
+ */
+#ifndef PIPELINE_MAX_REPLAY_PERIODS
+#define PIPELINE_MAX_REPLAY_PERIODS	16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	PIPELINE_IDLE,
+	PIPELINE_PLAYING,
+	PIPELINE_LISTENING,
+} pipeline_mode_t;
+
+typedef void (*pipeline_period_t)(const uint16_t *period);
+
+/*
+ * What the pipeline needs from the board. Any of them can be NULL.
+ */
+typedef struct {
+	// Called from the audio interrupt once a period has been recorded.
+	void (*recorded)(const uint16_t *period);
+	// Number of periods recorded since the start and replay of the ones
+	// still in the history, oldest first. See capture.h.
+	uint32_t (*recorded_count)(void);
+	uint32_t (*replay)(uint32_t first, uint32_t count, pipeline_period_t callback);
+	// Cache maintenance of the buffers read and written by the DMA.
+	void (*invalidate)(void *address, size_t size);
+	void (*clean)(const void *address, size_t size);
+	// Called once every period has been processed.
+	void (*processed)(void);
+	// Fill the next period to play in place of `loop`, returning false to
+	// let `loop` synthesise it, then given every period it synthesised once
+	// in the play buffer. See waveform.h.
+	bool (*fill)(uint16_t *period);
+	void (*played)(const uint16_t *period);
+} pipeline_hal_t;
+
+typedef struct {
+	// Interleaved buffers of `PIPELINE_BUFFER_LENGTH` samples, two periods
+	// each, one being transferred by the DMA while the other is processed.
+	uint16_t *record_buffer;
+	uint16_t *play_buffer;
+	// Mono buffer of `PIPELINE_FLOAT_LENGTH` samples given to `loop`.
+	float *float_buffer;
+	void (*loop)(float *buffer, uint16_t length);
+	// Whether `loop` can be skipped for a silent period, which should only be
+	// the case while the SDK is waiting for a chirp. Never skipped if NULL.
+	bool (*can_skip)(void);
+	const pipeline_hal_t *hal;
+} pipeline_config_t;
+
+void pipeline_init(const pipeline_config_t *config);
+
+void pipeline_set_mode(pipeline_mode_t mode);
+
+pipeline_mode_t pipeline_get_mode(void);
+
+int pipeline_beam_delay(void);
+
+bool pipeline_set_band(float low, float high, uint32_t sample_rate);
+
+bool pipeline_set_band_from_info(const char *info, uint32_t sample_rate);
+
+void pipeline_set_preprocess(bool enable);
+
+float pipeline_gain(void);
+
+void pipeline_set_gate(bool enable);
+
+uint32_t pipeline_skipped_periods(void);
+
+uint32_t pipeline_position(void);
+
+void pipeline_recorded(uint8_t half);
+
+void pipeline_played(uint8_t half);
+
+bool pipeline_pending(void);
+
+void pipeline_process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
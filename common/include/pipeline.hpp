@@ -0,0 +1,628 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+/*
+ * Compile time specialised audio pipeline. The sample format, the channel
+ * layout, the period length and the decimation are template parameters, so
+ * every loop has constant bounds and strides and the compiler can unroll and
+ * vectorise it. Nothing here allocates nor throws, it builds with
+ * -fno-exceptions -fno-rtti. The C API of pipeline.h is implemented on top
+ * of it in pipeline.cpp.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pipeline.h"
+
+// The conversion loops are inlined into the functions of pipeline.cpp, so
+// that they get placed with them by PIPELINE_TEXT.
+#define PIPELINE_INLINE	inline __attribute__((always_inline))
+
+namespace pipeline {
+
+/*
+ * Signed 16 bits samples, as the codecs and the PDM filter produce them,
+ * stored in the `uint16_t` buffers the BSP takes.
+ */
+struct Int16 {
+	using sample_type = uint16_t;
+
+	// Scale of the fixed point values, 1.0 being `1 << fraction_bits`.
+	static constexpr unsigned fraction_bits = 15;
+
+	static PIPELINE_INLINE float to_float(sample_type sample)
+	{
+		return static_cast<int16_t>(sample) * (1.0f / 32768.0f);
+	}
+
+	static PIPELINE_INLINE int16_t to_fixed(sample_type sample)
+	{
+		return static_cast<int16_t>(sample);
+	}
+
+	static PIPELINE_INLINE sample_type from_float(float sample)
+	{
+		if (sample > 1.0f)
+			sample = 1.0f;
+		if (sample < -1.0f)
+			sample = -1.0f;
+
+		return static_cast<sample_type>(static_cast<int16_t>(sample * 32767.0f));
+	}
+};
+
+/*
+ * Interleaved frames of `Channels` samples. `Channel` is the one decoded,
+ * the played audio is written on all of them.
+ */
+template <unsigned Channels, unsigned Channel = 0>
+struct Interleaved {
+	static_assert(Channels > 0, "a frame holds at least one sample");
+	static_assert(Channel < Channels, "the decoded channel is not in the frame");
+
+	static constexpr unsigned channels = Channels;
+	static constexpr unsigned channel = Channel;
+};
+
+/*
+ * Conversions between one period of a DMA buffer, `Frames` frames in the
+ * `Layout` of `Format` samples, and the mono float period given to the SDK,
+ * `Decimation` times shorter.
+ */
+template <typename Format, typename Layout, size_t Frames, unsigned Decimation = 1>
+struct Period {
+	static_assert(Decimation > 0 && Frames % Decimation == 0,
+			"a period holds a whole number of decimated samples");
+
+	using sample_type = typename Format::sample_type;
+
+	// Samples of a period in the DMA buffer, half of it.
+	static constexpr size_t samples = Frames * Layout::channels;
+	// Samples of a period given to the SDK.
+	static constexpr size_t length = Frames / Decimation;
+
+	/*
+	 * Extract the decoded channel of `in` into `out`, averaging every
+	 * `Decimation` frames.
+	 */
+	static PIPELINE_INLINE void deinterleave(const sample_type *__restrict in, float *__restrict out)
+	{
+		constexpr float scale = 1.0f / Decimation;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			float sum = 0;
+			for (unsigned j = 0; j < Decimation; j++)
+				sum += Format::to_float(in[(i * Decimation + j) * Layout::channels + Layout::channel]);
+
+			out[i] = Decimation == 1 ? sum : sum * scale;
+		}
+	}
+
+	/*
+	 * Write every sample of `in` on all the channels of `Decimation`
+	 * consecutive frames of `out`.
+	 */
+	static PIPELINE_INLINE void interleave(const float *__restrict in, sample_type *__restrict out)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			sample_type value = Format::from_float(in[i]);
+
+			for (unsigned j = 0; j < Decimation * Layout::channels; j++)
+				out[i * Decimation * Layout::channels + j] = value;
+		}
+	}
+};
+
+/*
+ * Sum of two 16 bits products at a time into a 64 bits accumulator, the
+ * SMLALD instruction of the Cortex-M4 and M7 DSP extension. Elsewhere the
+ * compiler vectorises the plain loop.
+ */
+template <size_t Length>
+static PIPELINE_INLINE int64_t dot(const int16_t *__restrict a, const int16_t *__restrict b)
+{
+	int64_t sum = 0;
+
+#if defined(__ARM_FEATURE_DSP)
+	static_assert(Length % 2 == 0, "pairs of samples are multiplied at once");
+
+	for (size_t i = 0; i < Length; i += 2)
+	{
+		uint32_t x, y;
+		memcpy(&x, &a[i], sizeof(x));
+		memcpy(&y, &b[i], sizeof(y));
+		__asm__ ("smlald %Q0, %R0, %1, %2" : "+r" (sum) : "r" (x), "r" (y));
+	}
+#else
+	for (size_t i = 0; i < Length; i++)
+		sum += static_cast<int32_t>(a[i]) * b[i];
+#endif
+
+	return sum;
+}
+
+/*
+ * Delay-and-sum beamformer over the first two channels of `Layout`, two
+ * microphones a few millimetres apart. A sound coming from the side reaches
+ * one of them up to `MaxDelay` frames before the other. Each period, the
+ * cross-correlation of the channels is computed for every delay within
+ * that range in fixed point and smoothed over the periods, and the channels
+ * are summed aligned on its peak. The chirp adds up coherently while the
+ * uncorrelated noise of the microphones does not, giving up to 3dB of SNR.
+ *
+ * The output is decimated the same way as `Period::deinterleave`. The last
+ * `MaxDelay` frames of each channel are kept from one period to the next so
+ * that the delayed channel is continuous.
+ */
+template <typename Format, typename Layout, size_t Frames, unsigned Decimation, unsigned MaxDelay>
+class DelayAndSum {
+	static_assert(Layout::channels >= 2, "two microphones are needed");
+	static_assert(MaxDelay > 0 && MaxDelay <= Frames, "the delay spans at most a period");
+
+	using period_type = Period<Format, Layout, Frames, Decimation>;
+	using sample_type = typename Format::sample_type;
+
+	static constexpr size_t lags = 2 * MaxDelay + 1;
+	// Weight of the last period in the smoothed correlation, 1/8.
+	static constexpr unsigned smoothing_bits = 3;
+
+public:
+	void reset()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	/*
+	 * Frames by which the second channel leads the first one, negative when
+	 * it lags behind.
+	 */
+	int delay() const
+	{
+		return delay_;
+	}
+
+	PIPELINE_INLINE void process(const sample_type *__restrict in, float *__restrict out)
+	{
+		for (size_t i = 0; i < Frames; i++)
+		{
+			first_[MaxDelay + i] = Format::to_fixed(in[i * Layout::channels]);
+			second_[MaxDelay + i] = Format::to_fixed(in[i * Layout::channels + 1]);
+		}
+
+		track();
+
+		// Delay the leading channel to align it with the other one.
+		const int16_t *a = &first_[MaxDelay - (delay_ < 0 ? -delay_ : 0)];
+		const int16_t *b = &second_[MaxDelay - (delay_ > 0 ? delay_ : 0)];
+		constexpr float scale = 1.0f / (2 * Decimation * (1 << Format::fraction_bits));
+
+		for (size_t i = 0; i < period_type::length; i++)
+		{
+			int32_t sum = 0;
+			for (unsigned j = 0; j < Decimation; j++)
+				sum += a[i * Decimation + j] + b[i * Decimation + j];
+
+			out[i] = sum * scale;
+		}
+
+		memcpy(first_, &first_[Frames], MaxDelay * sizeof(int16_t));
+		memcpy(second_, &second_[Frames], MaxDelay * sizeof(int16_t));
+	}
+
+private:
+	/*
+	 * Update the smoothed cross-correlation with the period just written
+	 * and follow its peak, keeping the current delay on a tie.
+	 */
+	PIPELINE_INLINE void track()
+	{
+		int64_t best = 0;
+		int next = delay_;
+
+		for (size_t k = 0; k < lags; k++)
+		{
+			int lag = static_cast<int>(k) - static_cast<int>(MaxDelay);
+			const int16_t *a = &first_[MaxDelay - (lag < 0 ? -lag : 0)];
+			const int16_t *b = &second_[MaxDelay - (lag > 0 ? lag : 0)];
+
+			int64_t &correlation = correlation_[k];
+			correlation += (dot<Frames>(a, b) - correlation) >> smoothing_bits;
+
+			if (k == 0 || correlation > best || (correlation == best && lag == delay_))
+			{
+				best = correlation;
+				next = lag;
+			}
+		}
+
+		delay_ = next;
+	}
+
+	int16_t first_[MaxDelay + Frames];
+	int16_t second_[MaxDelay + Frames];
+	int64_t correlation_[lags];
+	int delay_;
+};
+
+/*
+ * Second order IIR section in transposed direct form II, designed after the
+ * RBJ audio EQ cookbook. A section is recursive, its samples can only be
+ * computed one after the other, so it costs 5 multiply-accumulates a sample
+ * on the FPU whatever the target.
+ */
+class Biquad {
+public:
+	void high_pass(float frequency, float sample_rate)
+	{
+		design(frequency, sample_rate, false);
+	}
+
+	void low_pass(float frequency, float sample_rate)
+	{
+		design(frequency, sample_rate, true);
+	}
+
+	void clear()
+	{
+		z1_ = 0;
+		z2_ = 0;
+	}
+
+	template <size_t Length>
+	PIPELINE_INLINE void process(float *buffer)
+	{
+		float z1 = z1_;
+		float z2 = z2_;
+
+		for (size_t i = 0; i < Length; i++)
+		{
+			float in = buffer[i];
+			float out = b0_ * in + z1;
+
+			z1 = b1_ * in - a1_ * out + z2;
+			z2 = b2_ * in - a2_ * out;
+			buffer[i] = out;
+		}
+
+		// Silence leaves the state cycling through denormals, which are
+		// very slow on the host, flush it once far below any input.
+		z1_ = fabsf(z1) < 1e-20f ? 0 : z1;
+		z2_ = fabsf(z2) < 1e-20f ? 0 : z2;
+	}
+
+private:
+	// Butterworth response, flat in the pass band.
+	void design(float frequency, float sample_rate, bool low)
+	{
+		constexpr float pi = 3.14159265f;
+		constexpr float q = 0.70710678f;
+		float w = 2.0f * pi * frequency / sample_rate;
+		float cosine = cosf(w);
+		float alpha = sinf(w) / (2.0f * q);
+		float a0 = 1.0f + alpha;
+		float edge = low ? 1.0f - cosine : 1.0f + cosine;
+
+		b0_ = edge / 2.0f / a0;
+		b1_ = (low ? edge : -edge) / a0;
+		b2_ = b0_;
+		a1_ = -2.0f * cosine / a0;
+		a2_ = (1.0f - alpha) / a0;
+		clear();
+	}
+
+	// Pass everything through until designed.
+	float b0_ = 1.0f;
+	float b1_ = 0;
+	float b2_ = 0;
+	float a1_ = 0;
+	float a2_ = 0;
+	float z1_ = 0;
+	float z2_ = 0;
+};
+
+/*
+ * RMS level of a period.
+ */
+template <size_t Length>
+static PIPELINE_INLINE float rms(const float *buffer)
+{
+	float energy = 0;
+
+	for (size_t i = 0; i < Length; i++)
+		energy += buffer[i] * buffer[i];
+
+	return sqrtf(energy / Length);
+}
+
+/*
+ * Block automatic gain control with a look-ahead limiter. The gain follows
+ * the RMS level of the periods towards `Target`, dropping at once when the
+ * level rises and recovering over about 64 periods. As a whole period is
+ * known before any of it is scaled, the gain is also lowered before a peak
+ * rather than after it, so that no sample ever goes beyond `Limit`. The
+ * gain ramps across a period when it rises so that it does not step.
+ *
+ * The level measurement and the scaling have no dependency between samples
+ * and vectorise wherever the target has float SIMD.
+ */
+template <size_t Length>
+class Agc {
+	static constexpr float target = 0.1f;
+	static constexpr float limit = 0.9f;
+	static constexpr float min_gain = 0.1f;
+	static constexpr float max_gain = 10.0f;
+	static constexpr float release = 1.0f / 64;
+
+public:
+	void reset()
+	{
+		level_gain_ = 1.0f;
+		gain_ = 1.0f;
+	}
+
+	float gain() const
+	{
+		return gain_;
+	}
+
+	// Returns the RMS level of the period before it was scaled.
+	PIPELINE_INLINE float process(float *buffer)
+	{
+		float peak = 0;
+		float energy = 0;
+
+		for (size_t i = 0; i < Length; i++)
+		{
+			float sample = fabsf(buffer[i]);
+			peak = sample > peak ? sample : peak;
+			energy += buffer[i] * buffer[i];
+		}
+
+		float rms = sqrtf(energy / Length);
+		float wanted = rms * max_gain > target ? target / rms : max_gain;
+		if (wanted < min_gain)
+			wanted = min_gain;
+
+		level_gain_ = wanted < level_gain_ ? wanted : level_gain_ + (wanted - level_gain_) * release;
+
+		float next = level_gain_;
+		if (peak * next > limit)
+			next = limit / peak;
+
+		float start = next < gain_ ? next : gain_;
+		float step = (next - start) / Length;
+
+		for (size_t i = 0; i < Length; i++)
+			buffer[i] *= start + step * i;
+
+		gain_ = next;
+		return rms;
+	}
+
+private:
+	float level_gain_ = 1.0f;
+	float gain_ = 1.0f;
+};
+
+/*
+ * Pre-processing of the decoded audio: a band-pass made of a high-pass and a
+ * low-pass section, rejecting the rumble below the band of the protocol and
+ * the hiss above it, followed by the gain control. The filter is bypassed
+ * until a band is set.
+ */
+template <size_t Length>
+class Preprocessor {
+public:
+	bool set_band(float low, float high, float sample_rate)
+	{
+		if (high > sample_rate * 0.45f)
+			high = sample_rate * 0.45f;
+		if (low <= 0 || low >= high)
+			return false;
+
+		high_pass_.high_pass(low, sample_rate);
+		low_pass_.low_pass(high, sample_rate);
+		filtering_ = true;
+		return true;
+	}
+
+	void enable(bool enabled)
+	{
+		enabled_ = enabled;
+	}
+
+	void reset()
+	{
+		high_pass_.clear();
+		low_pass_.clear();
+		agc_.reset();
+	}
+
+	float gain() const
+	{
+		return agc_.gain();
+	}
+
+	/*
+	 * Returns the RMS level of the period before the gain control, within the
+	 * band once it is set.
+	 */
+	PIPELINE_INLINE float process(float *buffer)
+	{
+		if (!enabled_)
+			return rms<Length>(buffer);
+
+		if (filtering_)
+		{
+			high_pass_.process<Length>(buffer);
+			low_pass_.process<Length>(buffer);
+		}
+
+		return agc_.process(buffer);
+	}
+
+private:
+	Biquad high_pass_;
+	Biquad low_pass_;
+	Agc<Length> agc_;
+	bool filtering_ = false;
+	bool enabled_ = true;
+};
+
+/*
+ * Energy gate keeping silent periods from the SDK. The level of every period
+ * within the band of the protocol is compared with the noise floor, its
+ * average while the gate is closed. The gate opens as soon as a period is
+ * 2dB louder than the floor, and closes once `hold` periods in a row fell
+ * back under 1dB above it. The floor then hardly moves, so that a long chirp
+ * is not taken for the room, unless the room gets quieter.
+ *
+ * The gate starts open and stays so until the floor has been measured, that
+ * is until a period 2dB quieter than the loudest one so far, or silent, shows
+ * the room. The floor starts from the quietest period until then, so a chirp
+ * playing from the start is never taken for the room however long it lasts.
+ *
+ * While the gate is closed, the periods are kept in a ring of the last
+ * `Preroll` ones. When it opens, they are given to the decoder before the
+ * period which opened it, so that it also gets the start of the chirp and
+ * the audio before it.
+ */
+template <size_t Length, size_t Preroll>
+class Gate {
+	static constexpr float open_ratio = 1.26f;
+	static constexpr float close_ratio = 1.12f;
+	static constexpr unsigned hold = 16;
+	// Floor of digital silence, -80dBFS.
+	static constexpr float min_floor = 1e-4f;
+	// Weights of the level of a period in the floor when quieter, louder,
+	// and louder while the gate is open.
+	static constexpr float fall = 1.0f / 64;
+	static constexpr float rise = 1.0f / 256;
+	static constexpr float creep = 1.0f / 4096;
+
+public:
+	void reset()
+	{
+		floor_ = 0;
+		peak_ = 0;
+		measured_ = false;
+		open_ = true;
+		quiet_ = 0;
+		kept_ = 0;
+		next_ = 0;
+	}
+
+	void enable(bool enabled)
+	{
+		bypass_ = !enabled;
+	}
+
+	uint32_t skipped() const
+	{
+		return skipped_;
+	}
+
+	// Periods kept, given to the next `flush()`.
+	size_t kept() const
+	{
+		return kept_;
+	}
+
+	/*
+	 * Account for the level of the next period and return whether the gate
+	 * is open.
+	 */
+	PIPELINE_INLINE bool update(float level)
+	{
+		if (bypass_)
+			return true;
+
+		if (!measured_)
+		{
+			if (level > peak_)
+				peak_ = level;
+			if (floor_ == 0 || level < floor_)
+				floor_ = level;
+			if (floor_ < min_floor)
+				floor_ = min_floor;
+
+			measured_ = level * open_ratio < peak_ || level < min_floor;
+			return true;
+		}
+
+		if (open_)
+		{
+			quiet_ = level < floor_ * close_ratio ? quiet_ + 1 : 0;
+			open_ = quiet_ < hold;
+		}
+		else if (level > floor_ * open_ratio)
+		{
+			open_ = true;
+			quiet_ = 0;
+		}
+
+		float weight = level < floor_ ? fall : open_ ? creep : rise;
+		floor_ += (level - floor_) * weight;
+
+		if (floor_ < min_floor)
+			floor_ = min_floor;
+
+		return open_;
+	}
+
+	/*
+	 * Keep a period skipped while the gate is closed.
+	 */
+	PIPELINE_INLINE void keep(const float *buffer)
+	{
+		memcpy(ring_[next_], buffer, sizeof(ring_[0]));
+		next_ = (next_ + 1) % Preroll;
+		if (kept_ < Preroll)
+			kept_++;
+		skipped_++;
+	}
+
+	/*
+	 * Forget the periods kept, for instance once they are no longer right
+	 * before the next period.
+	 */
+	void discard()
+	{
+		kept_ = 0;
+	}
+
+	/*
+	 * Give the periods kept to `callback`, oldest first, and forget them.
+	 */
+	template <typename Callback>
+	PIPELINE_INLINE void flush(Callback callback)
+	{
+		for (size_t i = 0; i < kept_; i++)
+			callback(ring_[(next_ + Preroll - kept_ + i) % Preroll]);
+
+		kept_ = 0;
+	}
+
+private:
+	// Everything starts at zero so that the ring is not stored in flash.
+	float ring_[Preroll][Length];
+	size_t kept_;
+	size_t next_;
+	float floor_;
+	// Loudest period until the floor is measured.
+	float peak_;
+	unsigned quiet_;
+	uint32_t skipped_;
+	bool measured_;
+	bool open_;
+	bool bypass_;
+};
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chirp_sdk.h"
+
+/*
+ * Set to 1 by `make BINARY_TELEMETRY=1` to send the status lines as framed
+ * binary records rather than text, decoded on the host by
+ * tools/telemetry_decode.py. The other lines are still printed.
+ */
+#ifndef BINARY_TELEMETRY
+#define BINARY_TELEMETRY	0
+#endif
+
+/*
+ * Bytes of frames waiting to be sent on the serial line. Frames queued while
+ * it is full are dropped and counted. Can be overridden from the Makefile.
+ */
+#ifndef TELEMETRY_QUEUE_SIZE
+#define TELEMETRY_QUEUE_SIZE	1024
+#endif
+
+// Longest payload carried by a record, longer ones are cut.
+#define TELEMETRY_MAX_PAYLOAD	64
+
+// Format of the frames, sent in the boot record.
+#define TELEMETRY_VERSION		1
+
+typedef enum {
+	TELEMETRY_BOOT = 1,
+	TELEMETRY_STATE,
+	TELEMETRY_SENDING,
+	TELEMETRY_SENT,
+	TELEMETRY_RECEIVING,
+	TELEMETRY_RECEIVED,
+	TELEMETRY_LOAD,
+	TELEMETRY_CLOCK,
+	TELEMETRY_MEMORY,
+} telemetry_type_t;
+
+/*
+ * The serial line and the CRC unit of the board. `transmit` starts sending
+ * and returns, the board then calls `telemetry_transmitted()` from its
+ * interrupt. `crc` computes the CRC-32 of the STM32F4 CRC unit: polynomial
+ * 0x04C11DB7, initial value 0xFFFFFFFF, 32 bits words, no reflection.
+ */
+typedef struct {
+	bool (*transmit)(const uint8_t *data, size_t size);
+	uint32_t (*crc)(const uint32_t *words, size_t count);
+	// Milliseconds since the start, stamped on every record.
+	uint32_t (*time)(void);
+} telemetry_link_t;
+
+void telemetry_init(chirp_sdk_t *sdk, const telemetry_link_t *link);
+
+void telemetry_period(void);
+
+void telemetry_state(chirp_sdk_state_t old_state, chirp_sdk_state_t new_state);
+
+void telemetry_payload(telemetry_type_t type, const uint8_t *payload, size_t length, uint8_t channel);
+
+void telemetry_load(float average, float peak, uint32_t peak_cycles, uint32_t period_cycles);
+
+void telemetry_clock(uint32_t frequency, uint32_t running_peak, uint32_t sending_peak, uint32_t receiving_peak);
+
+// From the interrupt of the serial line, once `transmit` is done.
+void telemetry_transmitted(void);
+
+#endif
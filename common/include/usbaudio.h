@@ -0,0 +1,78 @@
+#ifndef USBAUDIO_H
+#define USBAUDIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Left, the audio given to the SDK to decode, right, the audio it synthesised.
+#define USBAUDIO_CHANNELS		2
+
+/*
+ * Frames waiting to be sent to the host, 8 bytes each. Periods replayed from
+ * the history or by the gate come in bursts, which are sent at up to
+ * `USBAUDIO_MAX_PACKET_FRAMES` a millisecond. Can be overridden from the
+ * Makefile.
+ */
+#ifndef USBAUDIO_RING_FRAMES
+#define USBAUDIO_RING_FRAMES	2048
+#endif
+
+// Most frames in the packet of a millisecond, 44 or 45 at 44.1kHz.
+#define USBAUDIO_MAX_PACKET_FRAMES	64
+
+#define USBAUDIO_EP0_SIZE		64
+#define USBAUDIO_STREAM_EP		0x81
+#define USBAUDIO_STREAM_EP_SIZE	(USBAUDIO_MAX_PACKET_FRAMES * USBAUDIO_CHANNELS * sizeof(float))
+
+#ifndef USBAUDIO_VENDOR_ID
+#define USBAUDIO_VENDOR_ID		0x0483
+#endif
+
+#ifndef USBAUDIO_PRODUCT_ID
+#define USBAUDIO_PRODUCT_ID		0x5730
+#endif
+
+/*
+ * The USB device controller of the board, all called from its interrupt.
+ * Endpoints are given by address, 0x80 set for the IN ones. `transmit` and
+ * `receive` start the transfer and return, the data must stay untouched
+ * until `usbaudio_in_complete()` is called for it.
+ */
+typedef struct {
+	void (*open)(uint8_t endpoint, uint16_t size, bool isochronous);
+	void (*close)(uint8_t endpoint);
+	void (*transmit)(uint8_t endpoint, const void *data, size_t size);
+	void (*receive)(uint8_t endpoint, void *data, size_t size);
+	void (*stall)(uint8_t endpoint);
+	void (*flush)(uint8_t endpoint);
+	void (*set_address)(uint8_t address);
+} usbaudio_device_t;
+
+typedef struct {
+	uint32_t frames;		// Frames sent to the host.
+	uint32_t dropped;		// Frames dropped because the ring was full.
+	uint32_t missed;		// Packets the host did not collect in their frame.
+	uint32_t peak;			// Most frames waiting in the ring.
+} usbaudio_stats_t;
+
+void usbaudio_init(const usbaudio_device_t *device, uint32_t sample_rate, const char *product);
+
+void usbaudio_write(const float *decoded, const float *played, size_t frames);
+
+bool usbaudio_streaming(void);
+
+void usbaudio_process(void);
+
+void usbaudio_get_stats(usbaudio_stats_t *stats);
+
+// From the interrupt of the USB device controller.
+void usbaudio_reset(void);
+
+void usbaudio_setup(const uint8_t *setup);
+
+void usbaudio_in_complete(uint8_t endpoint);
+
+void usbaudio_in_incomplete(uint8_t endpoint);
+
+#endif
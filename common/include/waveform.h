@@ -0,0 +1,58 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest payload cached, the one of the embedded protocols.
+#ifndef WAVEFORM_MAX_PAYLOAD
+#define WAVEFORM_MAX_PAYLOAD	32
+#endif
+
+// Payloads cached at once.
+#ifndef WAVEFORM_MAX_ENTRIES
+#define WAVEFORM_MAX_ENTRIES	16
+#endif
+
+// Periods of storage, two bytes of internal RAM each for their links.
+#ifndef WAVEFORM_MAX_BLOCKS
+#define WAVEFORM_MAX_BLOCKS		2048
+#endif
+
+/*
+ * Copy `size` bytes between the storage and a play buffer. The copy can run
+ * in the background, but must be over when the next one starts.
+ */
+typedef void (*waveform_copy_t)(void *destination, const void *source, size_t size);
+
+typedef struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t entries;
+	uint32_t used_bytes;
+	uint32_t size_bytes;
+} waveform_stats_t;
+
+void waveform_init(void *storage, size_t size, size_t period_size, waveform_copy_t copy);
+
+void waveform_invalidate(void);
+
+bool waveform_play(const uint8_t *payload, size_t length);
+
+bool waveform_playing(void);
+
+void waveform_stop(void);
+
+void waveform_record(const uint8_t *payload, size_t length);
+
+void waveform_record_end(void);
+
+bool waveform_fill(uint16_t *period);
+
+void waveform_played(const uint16_t *period);
+
+void waveform_get_stats(waveform_stats_t *stats);
+
+#endif
@@ -0,0 +1,130 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file adpcm.c
+ *
+ *  @brief IMA ADPCM, four bits per sample, to keep audio in the log store at
+ *  a quarter of its size. Good enough to hear and plot what failed to decode,
+ *  not to decode it again.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "adpcm.h"
+
+static const int8_t index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static const int16_t step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+/*
+ * Move the state by `code` and return the sample it decodes to.
+ */
+static int16_t step(adpcm_state_t *state, uint8_t code)
+{
+	int32_t size = step_table[state->index];
+	int32_t difference = size >> 3;
+
+	if (code & 4)
+		difference += size;
+	if (code & 2)
+		difference += size >> 1;
+	if (code & 1)
+		difference += size >> 2;
+
+	int32_t predicted = state->predicted + (code & 8 ? -difference : difference);
+	if (predicted > INT16_MAX)
+		predicted = INT16_MAX;
+	else if (predicted < INT16_MIN)
+		predicted = INT16_MIN;
+
+	int32_t index = state->index + index_table[code];
+	if (index < 0)
+		index = 0;
+	else if (index > 88)
+		index = 88;
+
+	state->predicted = (int16_t) predicted;
+	state->index = (uint8_t) index;
+
+	return state->predicted;
+}
+
+static uint8_t encode(adpcm_state_t *state, int16_t sample)
+{
+	int32_t difference = sample - state->predicted;
+	int32_t size = step_table[state->index];
+	uint8_t code = 0;
+
+	if (difference < 0)
+	{
+		code = 8;
+		difference = -difference;
+	}
+
+	if (difference >= size)
+	{
+		code |= 4;
+		difference -= size;
+	}
+	if (difference >= size >> 1)
+	{
+		code |= 2;
+		difference -= size >> 1;
+	}
+	if (difference >= size >> 2)
+		code |= 1;
+
+	// The encoder tracks what the decoder will see.
+	step(state, code);
+
+	return code;
+}
+
+/*
+ * Encode `count` samples, every `stride` of `samples` so that one channel of
+ * an interleaved buffer can be taken, into `(count + 1) / 2` bytes of
+ * `output`, first sample in the low nibble. Returns the bytes written.
+ */
+size_t adpcm_encode(adpcm_state_t *state, const int16_t *samples, size_t stride, size_t count, uint8_t *output)
+{
+	size_t length = 0;
+
+	for (size_t i = 0; i < count; i += 2)
+	{
+		uint8_t low = encode(state, samples[i * stride]);
+		uint8_t high = i + 1 < count ? encode(state, samples[(i + 1) * stride]) : 0;
+
+		output[length++] = low | high << 4;
+	}
+
+	return length;
+}
+
+/*
+ * Decode the `count` bytes of `input` into `2 * count` samples. Returns the
+ * samples written.
+ */
+size_t adpcm_decode(adpcm_state_t *state, const uint8_t *input, size_t count, int16_t *samples)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		samples[2 * i] = step(state, input[i] & 0x0F);
+		samples[2 * i + 1] = step(state, input[i] >> 4);
+	}
+
+	return 2 * count;
+}
@@ -0,0 +1,293 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file arena.c
+ *
+ *  @brief Fixed size heap replacing the newlib one. All the memory the Chirp
+ *  SDK and the C library allocate comes from a static arena placed in its own
+ *  linker section, instead of growing with `_sbrk()` until it meets the stack.
+ *
+ *  Blocks are carved first-fit from an address ordered free list and merged
+ *  with their free neighbours as soon as they are freed, so the arena does
+ *  not fragment when the SDK frees and allocates buffers of the same sizes
+ *  again. Nothing is ever allocated from interrupts, so no locking is needed.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+
+// Alignment of the returned pointers, enough for any type on a Cortex-M.
+#define ARENA_ALIGNMENT		8
+
+// Marks the header of an allocated block.
+#define ARENA_USED			0xA110C8EDu
+
+/*
+ * Header in front of every block. `size` includes the header. While the
+ * block is free it is linked in the free list, once allocated `next` is
+ * replaced by `ARENA_USED` to catch invalid frees.
+ */
+typedef struct arena_block {
+	size_t size;
+	union {
+		struct arena_block *next;
+		uint32_t tag;
+	};
+} __attribute__((aligned(ARENA_ALIGNMENT))) arena_block_t;
+
+// Smallest block worth splitting off, a header and a few bytes.
+#define ARENA_MIN_BLOCK		(2 * sizeof(arena_block_t))
+
+static uint8_t arena[ARENA_SIZE] __attribute__((section(".arena"), aligned(ARENA_ALIGNMENT)));
+
+static arena_block_t *free_list = NULL;
+static bool initialised = false;
+
+static size_t used = 0;
+static size_t peak = 0;
+static size_t allocations = 0;
+static size_t failures = 0;
+
+/*
+ * Make the whole arena a single free block. Done on the first allocation as
+ * the C library may allocate before `main()`.
+ */
+static void init(void)
+{
+	free_list = (arena_block_t *) arena;
+	free_list->size = ARENA_SIZE;
+	free_list->next = NULL;
+	initialised = true;
+}
+
+/*
+ * Size of the block needed for `size` bytes of payload, or 0 on overflow.
+ */
+static size_t block_size(size_t size)
+{
+	if (size > ARENA_SIZE)
+		return 0;
+
+	size_t total = (size + sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+	return total < ARENA_MIN_BLOCK ? ARENA_MIN_BLOCK : total;
+}
+
+static arena_block_t *header_of(void *pointer)
+{
+	return (arena_block_t *) pointer - 1;
+}
+
+/*
+ * Insert `block` in the free list, merging it with the blocks right before
+ * and after it if they are free.
+ */
+static void insert_free(arena_block_t *block)
+{
+	arena_block_t *previous = NULL;
+	arena_block_t *next = free_list;
+
+	while (next != NULL && next < block)
+	{
+		previous = next;
+		next = next->next;
+	}
+
+	if (next != NULL && (uint8_t *) block + block->size == (uint8_t *) next)
+	{
+		block->size += next->size;
+		block->next = next->next;
+	}
+	else
+	{
+		block->next = next;
+	}
+
+	if (previous == NULL)
+	{
+		free_list = block;
+	}
+	else if ((uint8_t *) previous + previous->size == (uint8_t *) block)
+	{
+		previous->size += block->size;
+		previous->next = block->next;
+	}
+	else
+	{
+		previous->next = block;
+	}
+}
+
+void *arena_alloc(size_t size)
+{
+	if (!initialised)
+		init();
+
+	size_t needed = block_size(size);
+	if (needed == 0)
+	{
+		failures++;
+		return NULL;
+	}
+
+	arena_block_t **link = &free_list;
+	while (*link != NULL && (*link)->size < needed)
+		link = &(*link)->next;
+
+	arena_block_t *block = *link;
+	if (block == NULL)
+	{
+		failures++;
+		return NULL;
+	}
+
+	if (block->size - needed >= ARENA_MIN_BLOCK)
+	{
+		arena_block_t *rest = (arena_block_t *) ((uint8_t *) block + needed);
+		rest->size = block->size - needed;
+		rest->next = block->next;
+		block->size = needed;
+		*link = rest;
+	}
+	else
+	{
+		*link = block->next;
+	}
+
+	block->tag = ARENA_USED;
+
+	used += block->size;
+	if (used > peak)
+		peak = used;
+	allocations++;
+
+	return block + 1;
+}
+
+void arena_free(void *pointer)
+{
+	if (pointer == NULL)
+		return;
+
+	arena_block_t *block = header_of(pointer);
+	if (block->tag != ARENA_USED)
+		return;
+
+	used -= block->size;
+	allocations--;
+
+	insert_free(block);
+}
+
+void *arena_realloc(void *pointer, size_t size)
+{
+	if (pointer == NULL)
+		return arena_alloc(size);
+
+	if (size == 0)
+	{
+		arena_free(pointer);
+		return NULL;
+	}
+
+	arena_block_t *block = header_of(pointer);
+	size_t needed = block_size(size);
+	if (needed == 0 || block->tag != ARENA_USED)
+	{
+		failures++;
+		return NULL;
+	}
+
+	// Shrinking, or growing within the rounding of the block, is done in place.
+	if (needed <= block->size)
+		return pointer;
+
+	void *moved = arena_alloc(size);
+	if (moved == NULL)
+		return NULL;
+
+	memcpy(moved, pointer, block->size - sizeof(arena_block_t));
+	arena_free(pointer);
+
+	return moved;
+}
+
+void arena_get_stats(arena_stats_t *stats)
+{
+	if (!initialised)
+		init();
+
+	size_t largest = 0;
+	for (arena_block_t *block = free_list; block != NULL; block = block->next)
+	{
+		if (block->size > largest)
+			largest = block->size;
+	}
+
+	stats->size = ARENA_SIZE;
+	stats->used = used;
+	stats->peak = peak;
+	stats->largest_free = largest > sizeof(arena_block_t) ? largest - sizeof(arena_block_t) : 0;
+	stats->allocations = allocations;
+	stats->failures = failures;
+}
+
+/*
+ * Replacements of the newlib allocator. Both the standard functions and their
+ * reentrant variants, used internally by the C library, are defined so that
+ * none of the newlib ones get linked.
+ */
+
+struct _reent;
+
+void *malloc(size_t size)
+{
+	return arena_alloc(size);
+}
+
+void free(void *pointer)
+{
+	arena_free(pointer);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	return arena_realloc(pointer, size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	if (size != 0 && count > SIZE_MAX / size)
+		return NULL;
+
+	void *pointer = arena_alloc(count * size);
+	if (pointer != NULL)
+		memset(pointer, 0, count * size);
+
+	return pointer;
+}
+
+void *_malloc_r(struct _reent *reent, size_t size)
+{
+	return malloc(size);
+}
+
+void _free_r(struct _reent *reent, void *pointer)
+{
+	free(pointer);
+}
+
+void *_realloc_r(struct _reent *reent, void *pointer, size_t size)
+{
+	return realloc(pointer, size);
+}
+
+void *_calloc_r(struct _reent *reent, size_t count, size_t size)
+{
+	return calloc(count, size);
+}
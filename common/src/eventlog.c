@@ -0,0 +1,383 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file eventlog.c
+ *
+ *  @brief Time stamped log of the callbacks of the SDK, to measure how long a
+ *  chirp takes to be delivered and how long it lasts on air. Every event is
+ *  stamped with a free-running microsecond timer and with its position in
+ *  the audio, in samples, which lines it up with the audio recorded or
+ *  played. The SDK does not tell where an event happened within the block it
+ *  was processing, the position is the one of the start of that block.
+ *
+ *  The callbacks only stamp the events and update the statistics, the events
+ *  are printed later from the main loop by `eventlog_process()`:
+ *
+ *      event <microseconds> <position> <event> <details>
+ *
+ *  Two latencies are measured for every payload received:
+ *
+ *  - decode, from `on_receiving` to `on_received`, how long the payload
+ *    takes to be delivered once the start of the chirp has been heard,
+ *  - end to end, from `on_sending` to `on_received`, when the payload is the
+ *    one last sent, heard by the SDK itself or by a loopback.
+ *
+ *  The air time of every payload sent, the samples from `on_sending` to
+ *  `on_sent`, is compared with `chirp_sdk_get_duration_for_payload_length()`.
+ *  It is measured in whole blocks, so it is short by up to a block.
+ *
+ *  Every `EVENTLOG_REPORT_SECONDS` in which something was measured, the
+ *  histograms of the latencies since the start are printed, in powers of two
+ *  of microseconds, along with the errors of the air time.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+
+#include "eventlog.h"
+
+// Buckets of the histograms: 0, then [1, 2), [2, 4) up to [2^31, 2^32) us.
+#define BUCKETS		33
+
+// Latency not measured.
+#define NONE		UINT32_MAX
+
+typedef struct {
+	uint32_t micros;
+	uint32_t position;
+	eventlog_type_t type;
+	uint8_t channel;
+	uint16_t length;
+	bool failed;
+	union {
+		struct {
+			chirp_sdk_state_t old_state;
+			chirp_sdk_state_t new_state;
+		} state;
+		// In samples.
+		struct {
+			uint32_t air_time;
+			uint32_t expected;
+		} sent;
+		// In microseconds, `NONE` when not measured.
+		struct {
+			uint32_t decode;
+			uint32_t end_to_end;
+		} received;
+	};
+} event_t;
+
+typedef struct {
+	const char *name;
+	uint32_t buckets[BUCKETS];
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+} histogram_t;
+
+static const char *const state_names[] = {
+	"not created", "stopped", "running", "sending", "receiving",
+};
+
+static chirp_sdk_t *eventlog_sdk = NULL;
+static const eventlog_clock_t *eventlog_clock = NULL;
+static uint32_t eventlog_rate = 0;
+
+// Written by the callbacks at `head`, printed from `tail`, both counting
+// events since the start.
+static event_t events[EVENTLOG_SIZE];
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t dropped = 0;
+
+// Last payload sent, recognised when received by its length and hash.
+static bool sending = false;
+static bool awaited = false;
+static uint32_t sending_micros = 0;
+static uint32_t sending_position = 0;
+static size_t sent_length = 0;
+static uint32_t sent_hash = 0;
+
+static bool receiving = false;
+static uint32_t receiving_micros = 0;
+
+static histogram_t decode = { .name = "decode" };
+static histogram_t end_to_end = { .name = "end to end" };
+
+// Air time measured less the one expected, in samples.
+static uint32_t air_time_count = 0;
+static int32_t air_time_min = 0;
+static int32_t air_time_max = 0;
+static int64_t air_time_sum = 0;
+
+static bool measured = false;
+static uint32_t report_micros = 0;
+
+static const char *state_name(chirp_sdk_state_t state)
+{
+	return (unsigned) state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "unknown";
+}
+
+// FNV-1a.
+static uint32_t hash(const uint8_t *payload, size_t length)
+{
+	uint32_t value = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		value = (value ^ payload[i]) * 16777619u;
+
+	return value;
+}
+
+static void histogram_add(histogram_t *histogram, uint32_t micros)
+{
+	unsigned bucket = micros ? 32 - __builtin_clz(micros) : 0;
+
+	histogram->buckets[bucket]++;
+	if (histogram->count == 0 || micros < histogram->min)
+		histogram->min = micros;
+	if (micros > histogram->max)
+		histogram->max = micros;
+	histogram->sum += micros;
+	histogram->count++;
+
+	measured = true;
+}
+
+static void air_time_add(int32_t error)
+{
+	if (air_time_count == 0 || error < air_time_min)
+		air_time_min = error;
+	if (air_time_count == 0 || error > air_time_max)
+		air_time_max = error;
+	air_time_sum += error;
+	air_time_count++;
+
+	measured = true;
+}
+
+static float to_ms(int64_t samples)
+{
+	return samples * 1000.0f / eventlog_rate;
+}
+
+static void store(const event_t *event)
+{
+	if (head - tail >= EVENTLOG_SIZE)
+	{
+		dropped++;
+		return;
+	}
+
+	events[head % EVENTLOG_SIZE] = *event;
+	head++;
+}
+
+static void print_event(const event_t *event)
+{
+	static const char *const names[] = { "state", "sending", "sent", "receiving", "received" };
+
+	printf("event %lu %lu %s", (unsigned long) event->micros, (unsigned long) event->position, names[event->type]);
+
+	switch (event->type)
+	{
+	case EVENTLOG_STATE:
+		printf(" %s -> %s\n", state_name(event->state.old_state), state_name(event->state.new_state));
+		break;
+
+	case EVENTLOG_SENDING:
+		printf(" channel %u, %u bytes\n", event->channel, event->length);
+		break;
+
+	case EVENTLOG_SENT:
+		printf(" channel %u, %u bytes, air time %.1f ms, %.1f ms expected\n", event->channel, event->length,
+				to_ms(event->sent.air_time), to_ms(event->sent.expected));
+		break;
+
+	case EVENTLOG_RECEIVING:
+		printf(" channel %u\n", event->channel);
+		break;
+
+	case EVENTLOG_RECEIVED:
+		if (event->failed)
+			printf(" channel %u, failed", event->channel);
+		else
+			printf(" channel %u, %u bytes", event->channel, event->length);
+		if (event->received.decode != NONE)
+			printf(", decoded in %lu us", (unsigned long) event->received.decode);
+		if (event->received.end_to_end != NONE)
+			printf(", %lu us after sending", (unsigned long) event->received.end_to_end);
+		printf("\n");
+		break;
+	}
+}
+
+static void print_histogram(const histogram_t *histogram)
+{
+	if (histogram->count == 0)
+		return;
+
+	printf("event %s latency: %lu payloads, %lu us min, %lu us average, %lu us max\n", histogram->name,
+			(unsigned long) histogram->count, (unsigned long) histogram->min,
+			(unsigned long) (histogram->sum / histogram->count), (unsigned long) histogram->max);
+
+	for (unsigned bucket = 0; bucket < BUCKETS; bucket++)
+	{
+		if (histogram->buckets[bucket] == 0)
+			continue;
+
+		unsigned long low = bucket ? 1ul << (bucket - 1) : 0;
+		unsigned long high = bucket ? (1ul << (bucket - 1)) * 2 - 1 : 0;
+		printf("event %s latency: %10lu to %10lu us: %lu\n", histogram->name, low, high,
+				(unsigned long) histogram->buckets[bucket]);
+	}
+}
+
+/*
+ * Start stamping the events with `clock`. `sample_rate` is the one of the
+ * SDK, which the positions count.
+ */
+void eventlog_init(chirp_sdk_t *sdk, const eventlog_clock_t *clock, uint32_t sample_rate)
+{
+	eventlog_sdk = sdk;
+	eventlog_clock = clock;
+	eventlog_rate = sample_rate;
+	report_micros = clock->micros();
+}
+
+void eventlog_state(chirp_sdk_state_t old_state, chirp_sdk_state_t new_state)
+{
+	if (eventlog_clock == NULL)
+		return;
+
+	event_t event = {
+		.micros = eventlog_clock->micros(),
+		.position = eventlog_clock->position(),
+		.type = EVENTLOG_STATE,
+		.state = { old_state, new_state },
+	};
+
+	store(&event);
+}
+
+/*
+ * Stamp the event of the `on_sending`, `on_sent`, `on_receiving` or
+ * `on_received` callback, given its arguments.
+ */
+void eventlog_payload(eventlog_type_t type, const uint8_t *payload, size_t length, uint8_t channel)
+{
+	if (eventlog_clock == NULL)
+		return;
+
+	event_t event = {
+		.micros = eventlog_clock->micros(),
+		.position = eventlog_clock->position(),
+		.type = type,
+		.channel = channel,
+		.length = length,
+		.failed = payload == NULL,
+	};
+
+	switch (type)
+	{
+	case EVENTLOG_SENDING:
+		sending = true;
+		awaited = true;
+		sending_micros = event.micros;
+		sending_position = event.position;
+		sent_length = length;
+		sent_hash = payload ? hash(payload, length) : 0;
+		break;
+
+	case EVENTLOG_SENT:
+	{
+		float duration = chirp_sdk_get_duration_for_payload_length(eventlog_sdk, length);
+
+		event.sent.air_time = sending ? event.position - sending_position : 0;
+		event.sent.expected = duration > 0 ? (uint32_t) (duration * eventlog_rate + 0.5f) : 0;
+		if (sending && duration > 0)
+			air_time_add((int32_t) (event.sent.air_time - event.sent.expected));
+		sending = false;
+		break;
+	}
+
+	case EVENTLOG_RECEIVING:
+		receiving = true;
+		receiving_micros = event.micros;
+		break;
+
+	case EVENTLOG_RECEIVED:
+		event.received.decode = NONE;
+		event.received.end_to_end = NONE;
+
+		if (payload && receiving)
+		{
+			event.received.decode = event.micros - receiving_micros;
+			histogram_add(&decode, event.received.decode);
+		}
+
+		if (payload && awaited && length == sent_length && hash(payload, length) == sent_hash)
+		{
+			event.received.end_to_end = event.micros - sending_micros;
+			histogram_add(&end_to_end, event.received.end_to_end);
+			awaited = false;
+		}
+
+		receiving = false;
+		break;
+
+	default:
+		return;
+	}
+
+	store(&event);
+}
+
+/*
+ * Print the events stamped since the last call, and the report of the
+ * latencies every `EVENTLOG_REPORT_SECONDS` if any was measured. Called from
+ * the main loop, never from the callbacks.
+ */
+void eventlog_process(void)
+{
+	if (eventlog_clock == NULL)
+		return;
+
+	for (; tail != head; tail++)
+		print_event(&events[tail % EVENTLOG_SIZE]);
+
+	if (dropped)
+	{
+		printf("event %lu events dropped\n", (unsigned long) dropped);
+		dropped = 0;
+	}
+
+	if (measured && eventlog_clock->micros() - report_micros >= EVENTLOG_REPORT_SECONDS * 1000000u)
+		eventlog_report();
+}
+
+/*
+ * Print the histograms of the latencies and the errors of the air time
+ * measured since the start.
+ */
+void eventlog_report(void)
+{
+	if (eventlog_clock == NULL)
+		return;
+
+	print_histogram(&decode);
+	print_histogram(&end_to_end);
+
+	if (air_time_count)
+	{
+		printf("event air time: %lu payloads, %.1f ms min, %.1f ms average, %.1f ms max error\n",
+				(unsigned long) air_time_count, to_ms(air_time_min), to_ms(air_time_sum / air_time_count),
+				to_ms(air_time_max));
+	}
+
+	measured = false;
+	report_micros = eventlog_clock->micros();
+}
@@ -0,0 +1,248 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file fieldlog.c
+ *
+ *  @brief What the examples keep in the log store: a record at every start,
+ *  one at every decode with the counts since the start, and the audio which
+ *  led to every failed decode, compressed to IMA ADPCM. The records are
+ *  stamped with the time and kept across resets, to find out afterwards how
+ *  a board did in the field.
+ *
+ *  The SDK reports the decodes while the pipeline runs, possibly while it is
+ *  replaying the history itself, so the audio is only replayed into the log
+ *  from the main loop, by `fieldlog_process()`.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "adpcm.h"
+#include "fieldlog.h"
+
+// Bytes of ADPCM for a period.
+#define PERIOD_BYTES	((PIPELINE_PERIOD_LENGTH + 1) / 2)
+
+static fieldlog_config_t config;
+static bool mounted = false;
+
+static uint32_t received = 0;
+static uint32_t failed = 0;
+
+// Audio of the last failed decode, waiting for the main loop.
+static uint32_t audio_first = 0;
+static uint32_t audio_periods = 0;
+static adpcm_state_t encoder;
+
+static const char *type_names[] = {
+	[FIELDLOG_BOOT] = "boot",
+	[FIELDLOG_DECODE] = "decode",
+	[FIELDLOG_AUDIO] = "audio",
+};
+
+static uint32_t max_audio_periods(void)
+{
+	uint32_t room = config.flash->sector_size - 2 * LOGSTORE_HEADER_SIZE - sizeof(fieldlog_audio_t);
+	uint32_t periods = room / PERIOD_BYTES;
+
+	return periods < FIELDLOG_AUDIO_PERIODS ? periods : FIELDLOG_AUDIO_PERIODS;
+}
+
+/*
+ * Mount the store, print what it holds and log the start.
+ */
+bool fieldlog_init(const fieldlog_config_t *fieldlog_config)
+{
+	config = *fieldlog_config;
+
+	mounted = logstore_mount(config.flash);
+	if (!mounted)
+	{
+		printf("Log store mount failed.\n");
+		return false;
+	}
+
+	fieldlog_print();
+
+	fieldlog_boot_t boot = {
+		.sample_rate = config.sample_rate,
+		.period_length = PIPELINE_PERIOD_LENGTH,
+		.channels = PIPELINE_CHANNELS,
+	};
+	logstore_append(FIELDLOG_BOOT, &boot, sizeof(boot));
+
+	return true;
+}
+
+/*
+ * Called from the `on_received` callback of the SDK, with a NULL `payload`
+ * if the decode failed.
+ */
+void fieldlog_decode(const uint8_t *payload, size_t length)
+{
+	if (!mounted)
+		return;
+
+	if (payload)
+		received++;
+	else
+		failed++;
+
+	fieldlog_decode_t record = {
+		.received = received,
+		.failed = failed,
+		.period = config.recorded_count ? config.recorded_count() : 0,
+		.length = payload ? length : 0,
+	};
+	logstore_append(FIELDLOG_DECODE, &record, sizeof(record));
+
+	// A failure reported while the audio of the previous one waits is about
+	// the same audio.
+	if (payload == NULL && config.replay && audio_periods == 0)
+	{
+		uint32_t periods = max_audio_periods();
+		if (periods > record.period)
+			periods = record.period;
+
+		audio_first = record.period - periods;
+		audio_periods = periods;
+	}
+}
+
+static void log_period(const uint16_t *period)
+{
+	uint8_t encoded[PERIOD_BYTES];
+	size_t length = adpcm_encode(&encoder, (const int16_t *) period, PIPELINE_CHANNELS, PIPELINE_PERIOD_LENGTH, encoded);
+
+	logstore_write(encoded, length);
+}
+
+/*
+ * Called from the main loop, logs the audio of the last failed decode and
+ * writes the records to the flash.
+ */
+void fieldlog_process(void)
+{
+	if (!mounted)
+		return;
+
+	if (audio_periods > 0)
+	{
+		fieldlog_audio_t header = {
+			.first = audio_first,
+			.periods = audio_periods,
+			.period_length = PIPELINE_PERIOD_LENGTH,
+			.sample_rate = config.sample_rate,
+		};
+
+		if (logstore_begin(FIELDLOG_AUDIO, sizeof(header) + audio_periods * PERIOD_BYTES))
+		{
+			logstore_write(&header, sizeof(header));
+			memset(&encoder, 0, sizeof(encoder));
+
+			// The periods already gone from the history are left as zeros.
+			config.replay(audio_first, audio_periods, log_period);
+			logstore_end();
+		}
+
+		audio_periods = 0;
+	}
+
+	logstore_process();
+}
+
+/*
+ * Print a summary of the store on the serial line.
+ */
+void fieldlog_print(void)
+{
+	logstore_stats_t stats;
+	logstore_get_stats(&stats);
+
+	printf("Log: %lu records from %lu, %lu of %lu sectors used, erased %lu times at most, "
+			"%lu bytes queued, %lu records dropped, %lu errors.\n",
+			(unsigned long) stats.records, (unsigned long) stats.first, (unsigned long) stats.sectors,
+			(unsigned long) stats.sector_count, (unsigned long) stats.erases, (unsigned long) stats.queued,
+			(unsigned long) stats.dropped, (unsigned long) stats.errors);
+}
+
+static void dump_audio(const logstore_record_t *record)
+{
+	fieldlog_audio_t header;
+	if (record->length < sizeof(header) || !logstore_read(record, 0, &header, sizeof(header)))
+		return;
+
+	printf("log,%lu,%lu,audio,%lu,%u,%u,%lu\n", (unsigned long) record->sequence, (unsigned long) record->time,
+			(unsigned long) header.first, header.periods, header.period_length, (unsigned long) header.sample_rate);
+
+	if (header.period_length > PIPELINE_PERIOD_LENGTH)
+		return;
+
+	uint32_t bytes = (header.period_length + 1) / 2;
+	uint8_t encoded[PERIOD_BYTES];
+	int16_t samples[2 * PERIOD_BYTES];
+	adpcm_state_t decoder = {0};
+
+	for (uint32_t i = 0; i < header.periods; i++)
+	{
+		if (!logstore_read(record, sizeof(header) + i * bytes, encoded, bytes))
+			return;
+
+		adpcm_decode(&decoder, encoded, bytes, samples);
+
+		printf("audio,%lu,%lu,", (unsigned long) record->sequence, (unsigned long) (header.first + i));
+		for (uint32_t j = 0; j < header.period_length; j++)
+			printf("%04x", (uint16_t) samples[j]);
+		printf("\n");
+	}
+}
+
+static bool dump_record(const logstore_record_t *record, void *context)
+{
+	const char *name = record->type < sizeof(type_names) / sizeof(type_names[0]) && type_names[record->type] ?
+			type_names[record->type] : "unknown";
+
+	if (record->type == FIELDLOG_AUDIO)
+	{
+		dump_audio(record);
+		return true;
+	}
+
+	printf("log,%lu,%lu,%s", (unsigned long) record->sequence, (unsigned long) record->time, name);
+
+	if (record->type == FIELDLOG_BOOT && record->length == sizeof(fieldlog_boot_t))
+	{
+		fieldlog_boot_t boot;
+		if (logstore_read(record, 0, &boot, sizeof(boot)))
+			printf(",%lu,%u,%u", (unsigned long) boot.sample_rate, boot.period_length, boot.channels);
+	}
+	else if (record->type == FIELDLOG_DECODE && record->length == sizeof(fieldlog_decode_t))
+	{
+		fieldlog_decode_t decode;
+		if (logstore_read(record, 0, &decode, sizeof(decode)))
+			printf(",%lu,%lu,%lu,%lu", (unsigned long) decode.received, (unsigned long) decode.failed,
+					(unsigned long) decode.period, (unsigned long) decode.length);
+	}
+
+	printf("\n");
+
+	return true;
+}
+
+/*
+ * Print every record in the flash on the serial line as CSV, oldest first,
+ * the audio decoded with one period per line as `capture_dump()` does.
+ */
+void fieldlog_dump(void)
+{
+	if (!mounted)
+		return;
+
+	logstore_flush();
+
+	printf("log,sequence,time,type,fields\n");
+	logstore_iterate(dump_record, NULL);
+}
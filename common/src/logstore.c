@@ -0,0 +1,559 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file logstore.c
+ *
+ *  @brief Log of records kept in a NOR flash, such as the QSPI flash of the
+ *  boards. The store is a ring of sectors written one after the other, each
+ *  one starting with a header holding its sequence number and how many times
+ *  it has been erased. Once every sector is used, the oldest one is erased
+ *  for the next records, so every sector is erased as often as the others.
+ *
+ *  Records are appended to a queue in RAM and returned straight away. The
+ *  main loop calls `logstore_process()`, which starts the next erase or page
+ *  program only once the flash is done with the previous one, and never waits
+ *  for it. Records are written whole in a sector and their header holds a
+ *  CRC, so a record cut by a reset is found when the store is mounted again
+ *  and the writes go on in the next sector.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "logstore.h"
+
+#define SECTOR_MAGIC	0x4C53
+#define RECORD_MAGIC	0x5243
+#define ERASED_MAGIC	0xFFFF
+
+#define NO_SECTOR		0xFFFFFFFFu
+
+typedef struct {
+	uint16_t magic;
+	// CRC of the rest of the header.
+	uint16_t check;
+	uint32_t sequence;
+	uint32_t erases;
+	// Sequence of the first record of the sector.
+	uint32_t first;
+} sector_header_t;
+
+typedef struct {
+	uint16_t magic;
+	// CRC of the header, with `check` as 0, and of the data.
+	uint16_t check;
+	uint8_t type;
+	uint8_t reserved;
+	uint16_t length;
+	uint32_t sequence;
+	uint32_t time;
+} record_header_t;
+
+_Static_assert(sizeof(sector_header_t) == LOGSTORE_HEADER_SIZE, "Sector header size");
+_Static_assert(sizeof(record_header_t) == LOGSTORE_HEADER_SIZE, "Record header size");
+
+static const logstore_flash_t *flash = NULL;
+static uint32_t sector_count = 0;
+
+// Sector being written, and the next byte written in it.
+static uint32_t sector = NO_SECTOR;
+static uint32_t offset = 0;
+static uint32_t sector_sequence = 0;
+// Set while the header of `sector` waits for its erase to be over.
+static bool opening = false;
+// Bytes of the current record still to program.
+static uint32_t record_remaining = 0;
+static uint32_t record_sequence = 0;
+
+// Sequence of the oldest record in the flash, of the next one written and
+// of the next one appended.
+static uint32_t first_sequence = 0;
+static uint32_t written_sequence = 0;
+static uint32_t next_sequence = 0;
+
+// Ring of records waiting to be written, the complete ones first.
+static uint8_t queue[LOGSTORE_QUEUE_SIZE];
+static uint32_t queue_head = 0;
+static uint32_t queue_used = 0;
+static uint32_t queue_committed = 0;
+
+// Record being appended.
+static bool appending = false;
+static uint32_t append_start = 0;
+static uint32_t append_remaining = 0;
+static uint16_t append_check = 0;
+
+// Source of the page being programmed, which must not change meanwhile.
+static uint8_t staging[LOGSTORE_PAGE_SIZE];
+
+static logstore_stats_t stats;
+
+/*
+ * CRC-16/CCITT, bit by bit, which is fast enough for the few records logged.
+ */
+static uint16_t crc16(uint16_t crc, const void *data, size_t length)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t) bytes[i] << 8;
+		for (int bit = 0; bit < 8; bit++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+
+	return crc;
+}
+
+static uint32_t sector_address(uint32_t index)
+{
+	return flash->address + index * flash->sector_size;
+}
+
+static uint32_t max_record_length(void)
+{
+	return flash->sector_size - 2 * LOGSTORE_HEADER_SIZE;
+}
+
+static void wait_idle(void)
+{
+	while (flash->busy())
+		;
+}
+
+static bool read_sector_header(uint32_t index, sector_header_t *header)
+{
+	if (!flash->read(sector_address(index), header, sizeof(*header)))
+		return false;
+
+	return header->magic == SECTOR_MAGIC &&
+			header->check == crc16(0xFFFF, &header->sequence, sizeof(*header) - 2 * sizeof(uint16_t));
+}
+
+/*
+ * Read the header of the record at `address` and check it along with its
+ * data. Returns false at the end of the records of a sector.
+ */
+static bool read_record(uint32_t address, uint32_t end, record_header_t *header)
+{
+	if (address + sizeof(*header) > end || !flash->read(address, header, sizeof(*header)))
+		return false;
+
+	if (header->magic != RECORD_MAGIC || header->length > end - address - sizeof(*header))
+		return false;
+
+	record_header_t copy = *header;
+	copy.check = 0;
+	uint16_t check = crc16(0xFFFF, &copy, sizeof(copy));
+
+	for (uint32_t done = 0; done < header->length; )
+	{
+		uint32_t count = header->length - done;
+		if (count > sizeof(staging))
+			count = sizeof(staging);
+
+		if (!flash->read(address + sizeof(*header) + done, staging, count))
+			return false;
+		check = crc16(check, staging, count);
+		done += count;
+	}
+
+	return check == header->check;
+}
+
+static bool is_erased(const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (bytes[i] != 0xFF)
+			return false;
+	}
+
+	return true;
+}
+
+static void push(const void *data, uint32_t length)
+{
+	const uint8_t *bytes = data;
+	uint32_t index = (queue_head + queue_used) % LOGSTORE_QUEUE_SIZE;
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		queue[index] = bytes[i];
+		index = index + 1 < LOGSTORE_QUEUE_SIZE ? index + 1 : 0;
+	}
+
+	queue_used += length;
+}
+
+static void peek(void *data, uint32_t length)
+{
+	uint8_t *bytes = data;
+	uint32_t index = queue_head;
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		bytes[i] = queue[index];
+		index = index + 1 < LOGSTORE_QUEUE_SIZE ? index + 1 : 0;
+	}
+}
+
+static void pop(void *data, uint32_t length)
+{
+	peek(data, length);
+
+	queue_head = (queue_head + length) % LOGSTORE_QUEUE_SIZE;
+	queue_used -= length;
+	queue_committed -= length;
+}
+
+/*
+ * Erase the sector after the current one for the records starting at
+ * `sequence`. Its header is programmed once the erase is over.
+ */
+static void open_sector(uint32_t sequence)
+{
+	uint32_t target = sector == NO_SECTOR ? 0 : (sector + 1) % sector_count;
+	sector_header_t old;
+	bool used = read_sector_header(target, &old);
+
+	sector_header_t header = {
+		.magic = SECTOR_MAGIC,
+		.sequence = ++sector_sequence,
+		.erases = used ? old.erases + 1 : 1,
+		.first = sequence,
+	};
+	header.check = crc16(0xFFFF, &header.sequence, sizeof(header) - 2 * sizeof(uint16_t));
+
+	if (used)
+	{
+		// The oldest records go, the next sector holds the oldest ones left.
+		sector_header_t next;
+		if (read_sector_header((target + 1) % sector_count, &next) && next.sequence < header.sequence)
+			first_sequence = next.first;
+		else
+			first_sequence = sequence;
+	}
+	else
+	{
+		stats.sectors++;
+		if (sector == NO_SECTOR)
+			first_sequence = sequence;
+	}
+
+	if (header.erases > stats.erases)
+		stats.erases = header.erases;
+
+	memcpy(staging, &header, sizeof(header));
+	if (!flash->erase(sector_address(target)))
+		stats.errors++;
+
+	sector = target;
+	offset = sizeof(header);
+	opening = true;
+}
+
+/*
+ * Use the store described by `flash_config`, which must stay valid, and find
+ * where the last records were written. Blocks while it reads the header of
+ * every sector, so it belongs to the start.
+ */
+bool logstore_mount(const logstore_flash_t *flash_config)
+{
+	flash = NULL;
+	memset(&stats, 0, sizeof(stats));
+	queue_head = queue_used = queue_committed = 0;
+	appending = false;
+	opening = false;
+	record_remaining = 0;
+	sector = NO_SECTOR;
+	sector_sequence = 0;
+
+	if (flash_config->page_size > LOGSTORE_PAGE_SIZE || flash_config->sector_size % flash_config->page_size != 0 ||
+			flash_config->size / flash_config->sector_size < 2)
+		return false;
+
+	flash = flash_config;
+	sector_count = flash->size / flash->sector_size;
+	stats.sector_count = sector_count;
+	wait_idle();
+
+	sector_header_t oldest = {0};
+	for (uint32_t i = 0; i < sector_count; i++)
+	{
+		sector_header_t header;
+		if (!read_sector_header(i, &header))
+			continue;
+
+		if (sector == NO_SECTOR || header.sequence > sector_sequence)
+		{
+			sector = i;
+			sector_sequence = header.sequence;
+		}
+		if (stats.sectors == 0 || header.sequence < oldest.sequence)
+			oldest = header;
+		if (header.erases > stats.erases)
+			stats.erases = header.erases;
+		stats.sectors++;
+	}
+
+	if (sector == NO_SECTOR)
+	{
+		first_sequence = written_sequence = next_sequence = 0;
+		return true;
+	}
+
+	// Count the records of the last sector, up to the first erased header.
+	sector_header_t header;
+	read_sector_header(sector, &header);
+	uint32_t start = sector_address(sector);
+	uint32_t end = start + flash->sector_size;
+	uint32_t sequence = header.first;
+
+	offset = sizeof(header);
+	while (offset < flash->sector_size)
+	{
+		record_header_t record;
+		if (!read_record(start + offset, end, &record))
+		{
+			// Anything but erased flash was cut by a reset, write the next
+			// records in the next sector.
+			if (offset + sizeof(record) > flash->sector_size || !flash->read(start + offset, &record, sizeof(record)) ||
+					!is_erased(&record, sizeof(record)))
+				offset = flash->sector_size;
+			break;
+		}
+
+		offset += sizeof(record) + record.length;
+		sequence = record.sequence + 1;
+	}
+
+	first_sequence = oldest.first;
+	written_sequence = next_sequence = sequence;
+
+	return true;
+}
+
+/*
+ * Start appending a record of `type` holding `length` bytes, given by
+ * `logstore_write()` and ended by `logstore_end()`. Returns false, and the
+ * record is dropped, if the queue has no room for it.
+ */
+bool logstore_begin(uint8_t type, size_t length)
+{
+	if (flash == NULL || appending)
+		return false;
+
+	if (length > max_record_length() || queue_used + LOGSTORE_HEADER_SIZE + length > LOGSTORE_QUEUE_SIZE)
+	{
+		stats.dropped++;
+		return false;
+	}
+
+	record_header_t header = {
+		.magic = RECORD_MAGIC,
+		.check = 0,
+		.type = type,
+		.reserved = 0xFF,
+		.length = (uint16_t) length,
+		.sequence = next_sequence++,
+		.time = flash->time ? flash->time() : 0,
+	};
+
+	append_start = (queue_head + queue_used) % LOGSTORE_QUEUE_SIZE;
+	append_check = crc16(0xFFFF, &header, sizeof(header));
+	append_remaining = length;
+	appending = true;
+
+	push(&header, sizeof(header));
+
+	return true;
+}
+
+/*
+ * Append `length` bytes to the data of the record begun, up to the length
+ * given to `logstore_begin()`.
+ */
+void logstore_write(const void *data, size_t length)
+{
+	if (!appending)
+		return;
+
+	if (length > append_remaining)
+		length = append_remaining;
+
+	append_check = crc16(append_check, data, length);
+	append_remaining -= length;
+	push(data, length);
+}
+
+/*
+ * End the record begun, padded with zeros if it is short of its length. It
+ * is written from then on.
+ */
+void logstore_end(void)
+{
+	static const uint8_t zeros[16] = {0};
+
+	if (!appending)
+		return;
+
+	while (append_remaining > 0)
+		logstore_write(zeros, append_remaining < sizeof(zeros) ? append_remaining : sizeof(zeros));
+
+	// The CRC is only known now, patch it into the header.
+	uint32_t index = (append_start + offsetof(record_header_t, check)) % LOGSTORE_QUEUE_SIZE;
+	queue[index] = append_check & 0xFF;
+	queue[(index + 1) % LOGSTORE_QUEUE_SIZE] = append_check >> 8;
+
+	queue_committed = queue_used;
+	appending = false;
+}
+
+/*
+ * Append a record of `type` holding the `length` bytes of `data`.
+ */
+bool logstore_append(uint8_t type, const void *data, size_t length)
+{
+	if (!logstore_begin(type, length))
+		return false;
+
+	logstore_write(data, length);
+	logstore_end();
+
+	return true;
+}
+
+/*
+ * Called from the main loop, starts the next erase or program if the flash
+ * is done with the previous one. Every call programs a page at most.
+ */
+void logstore_process(void)
+{
+	if (flash == NULL || flash->busy())
+		return;
+
+	if (opening)
+	{
+		if (!flash->program(sector_address(sector), staging, LOGSTORE_HEADER_SIZE))
+			stats.errors++;
+		opening = false;
+		return;
+	}
+
+	if (record_remaining == 0)
+	{
+		if (queue_committed == 0)
+			return;
+
+		record_header_t header;
+		peek(&header, sizeof(header));
+
+		uint32_t total = sizeof(header) + header.length;
+		if (sector == NO_SECTOR || offset + total > flash->sector_size)
+		{
+			open_sector(header.sequence);
+			return;
+		}
+
+		record_remaining = total;
+		record_sequence = header.sequence;
+	}
+
+	// Up to the end of the page, which a program cannot cross.
+	uint32_t address = sector_address(sector) + offset;
+	uint32_t count = flash->page_size - address % flash->page_size;
+	if (count > record_remaining)
+		count = record_remaining;
+
+	pop(staging, count);
+	if (!flash->program(address, staging, count))
+		stats.errors++;
+
+	offset += count;
+	record_remaining -= count;
+	if (record_remaining == 0)
+		written_sequence = record_sequence + 1;
+}
+
+/*
+ * Write every record appended, waiting for the flash. For the end of a run
+ * or before a reset, never from the audio path.
+ */
+void logstore_flush(void)
+{
+	if (flash == NULL)
+		return;
+
+	while (queue_committed > 0 || record_remaining > 0 || opening)
+		logstore_process();
+
+	wait_idle();
+}
+
+/*
+ * Call `callback` with every record in the flash, oldest first. Waits for
+ * the flash to be done with the operation running.
+ */
+void logstore_iterate(logstore_callback_t callback, void *context)
+{
+	if (flash == NULL || sector == NO_SECTOR)
+		return;
+
+	wait_idle();
+
+	for (uint32_t i = 1; i <= sector_count; i++)
+	{
+		uint32_t index = (sector + i) % sector_count;
+		sector_header_t header;
+		if (!read_sector_header(index, &header))
+			continue;
+
+		uint32_t start = sector_address(index);
+		uint32_t end = start + flash->sector_size;
+		uint32_t address = start + sizeof(header);
+		record_header_t record;
+
+		while (read_record(address, end, &record))
+		{
+			logstore_record_t found = {
+				.sequence = record.sequence,
+				.time = record.time,
+				.type = record.type,
+				.length = record.length,
+				.address = address + sizeof(record),
+			};
+
+			if (!callback(&found, context))
+				return;
+
+			address += sizeof(record) + record.length;
+		}
+	}
+}
+
+/*
+ * Read `size` bytes of the data of `record` from `offset`.
+ */
+bool logstore_read(const logstore_record_t *record, uint32_t offset, void *data, size_t size)
+{
+	if (flash == NULL || offset > record->length || size > record->length - offset)
+		return false;
+
+	wait_idle();
+
+	return flash->read(record->address + offset, data, size);
+}
+
+void logstore_get_stats(logstore_stats_t *out)
+{
+	*out = stats;
+	out->records = written_sequence - first_sequence;
+	out->first = first_sequence;
+	out->next = next_sequence;
+	out->queued = queue_used;
+}
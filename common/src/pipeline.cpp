@@ -0,0 +1,441 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file pipeline.cpp
+ *
+ *  @brief Audio path shared by the boards, between the DMA double buffers
+ *  and the application `loop()`. The audio interrupts only tell which half
+ *  of a buffer is ready, the main loop then converts the recorded period
+ *  from interleaved 16 bits samples to mono float, or the played one the
+ *  other way round. Everything specific to a board, keeping a history of
+ *  the recorded audio, the cache maintenance or the CPU load accounting,
+ *  goes through the `pipeline_hal_t` hooks.
+ *
+ *  The conversions are those of pipeline.hpp, specialised for the period
+ *  described in the pipeline_conf.h of the board. This file implements the
+ *  C API of pipeline.h on top of them.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipeline.hpp"
+
+using period_t = pipeline::Period<
+		pipeline::Int16,
+		pipeline::Interleaved<PIPELINE_CHANNELS, PIPELINE_RECORD_CHANNEL>,
+		PIPELINE_PERIOD_LENGTH,
+		PIPELINE_DECIMATION>;
+
+#if PIPELINE_BEAMFORMING
+using beamformer_t = pipeline::DelayAndSum<
+		pipeline::Int16,
+		pipeline::Interleaved<PIPELINE_CHANNELS, PIPELINE_RECORD_CHANNEL>,
+		PIPELINE_PERIOD_LENGTH,
+		PIPELINE_DECIMATION,
+		PIPELINE_MAX_DELAY>;
+
+static PIPELINE_BSS beamformer_t beamformer;
+#endif
+
+#if PIPELINE_PREPROCESS
+static pipeline::Preprocessor<PIPELINE_FLOAT_LENGTH> preprocessor;
+
+/*
+ * Band of the protocols, found by name in the string returned by
+ * `chirp_sdk_get_info()`. They are kept a little wider than the tones of
+ * the protocols, the point is to reject the rumble and the hiss.
+ */
+static const struct {
+	const char *name;
+	float low;
+	float high;
+} bands[] = {
+	{ "ultrasonic", 16000.0f, 21000.0f },
+	{ "16khz", 600.0f, 7500.0f },
+	{ "standard", 600.0f, 9000.0f },
+};
+#endif
+
+#if PIPELINE_GATE
+static pipeline::Gate<PIPELINE_FLOAT_LENGTH, PIPELINE_GATE_PREROLL> gate;
+#endif
+
+static_assert(period_t::samples * 2 == PIPELINE_BUFFER_LENGTH, "two periods per buffer");
+static_assert(period_t::length == PIPELINE_FLOAT_LENGTH, "one float buffer per period");
+
+/*
+ * Used to keep track of the state of buffers.
+ */
+typedef enum {
+	BUFFER_STATE_EMPTY,
+	BUFFER_STATE_HALF,
+	BUFFER_STATE_FULL,
+} buffer_state_t;
+
+static pipeline_config_t settings;
+static pipeline_mode_t mode = PIPELINE_IDLE;
+
+// Written by the audio interrupts.
+static volatile buffer_state_t record_state = BUFFER_STATE_EMPTY;
+static volatile uint32_t record_offset = 0;
+static volatile buffer_state_t play_state = BUFFER_STATE_EMPTY;
+static volatile uint32_t play_offset = 0;
+
+// Index of the next recorded period to decode, see `recorded_count`.
+static uint32_t decoded_periods = 0;
+
+// Periods recorded and played since the start, counted by the audio
+// interrupts, and the index of the one given to `loop`, see
+// `pipeline_position()`.
+static volatile uint32_t recorded_periods = 0;
+static volatile uint32_t played_periods = 0;
+static uint32_t loop_period = 0;
+
+/*
+ * Convert a recorded period, the decoded channel or the beam of half of the
+ * record buffer, into the float buffer and give it to the application. With
+ * the gate, silent periods are only kept for the pre-roll while the
+ * application allows it.
+ */
+static PIPELINE_TEXT void decode_period(const uint16_t *period)
+{
+	float *buffer = settings.float_buffer;
+
+#if PIPELINE_BEAMFORMING
+	beamformer.process(period, buffer);
+#else
+	period_t::deinterleave(period, buffer);
+#endif
+
+#if PIPELINE_GATE
+	bool open = gate.update(preprocessor.process(buffer));
+
+	if (!open && settings.can_skip && settings.can_skip())
+	{
+		gate.keep(buffer);
+		return;
+	}
+
+	// The periods kept were recorded right before this one.
+	loop_period -= gate.kept();
+	gate.flush([](float *kept) {
+		settings.loop(kept, period_t::length);
+		loop_period++;
+	});
+#elif PIPELINE_PREPROCESS
+	preprocessor.process(buffer);
+#endif
+
+	settings.loop(buffer, period_t::length);
+}
+
+static void replay_period(const uint16_t *period)
+{
+	decode_period(period);
+	loop_period++;
+}
+
+/*
+ * Periods recorded while the main loop was busy, for instance redrawing the
+ * screen, are overwritten in the record buffer before being decoded. Replay
+ * them from the history so the decoder still gets continuous audio.
+ */
+static void replay_missed_periods(void)
+{
+	const pipeline_hal_t *hal = settings.hal;
+	if (hal->recorded_count == NULL)
+		return;
+
+	uint32_t count = hal->recorded_count();
+	if (count == 0)
+		return;
+
+	// The latest period is before the next one to decode when it was
+	// recorded before listening started.
+	uint32_t latest = count - 1;
+	uint32_t missed = latest > decoded_periods ? latest - decoded_periods : 0;
+	uint32_t replayed = 0;
+
+	if (missed > 0 && missed <= PIPELINE_MAX_REPLAY_PERIODS && hal->replay)
+	{
+		loop_period = decoded_periods;
+		replayed = hal->replay(decoded_periods, missed, replay_period);
+	}
+
+	if (replayed < missed)
+		printf("%lu audio periods lost.\n", (unsigned long) (missed - replayed));
+
+	decoded_periods = latest + 1;
+}
+
+static PIPELINE_TEXT void listen(void)
+{
+	const pipeline_hal_t *hal = settings.hal;
+	uint16_t *period = &settings.record_buffer[record_offset];
+	size_t size = period_t::samples * sizeof(uint16_t);
+
+	replay_missed_periods();
+	loop_period = recorded_periods - 1;
+
+	if (hal->invalidate)
+		hal->invalidate(period, size);
+
+	decode_period(period);
+
+	record_state = BUFFER_STATE_EMPTY;
+}
+
+static PIPELINE_TEXT void play(void)
+{
+	const pipeline_hal_t *hal = settings.hal;
+	uint16_t *period = &settings.play_buffer[play_offset];
+	float *buffer = settings.float_buffer;
+
+	// The DMA is sending the other half, this one is played after it.
+	loop_period = played_periods + 1;
+
+	if (hal->fill && hal->fill(period))
+	{
+		play_state = BUFFER_STATE_EMPTY;
+		return;
+	}
+
+	settings.loop(buffer, period_t::length);
+
+	period_t::interleave(buffer, period);
+
+	if (hal->clean)
+		hal->clean(period, period_t::samples * sizeof(uint16_t));
+
+	if (hal->played)
+		hal->played(period);
+
+	play_state = BUFFER_STATE_EMPTY;
+}
+
+/*
+ * `config` is copied, the buffers and `hal` it points to must outlive the
+ * pipeline.
+ */
+void pipeline_init(const pipeline_config_t *config)
+{
+	settings = *config;
+	mode = PIPELINE_IDLE;
+	record_state = BUFFER_STATE_EMPTY;
+	play_state = BUFFER_STATE_EMPTY;
+	decoded_periods = 0;
+	recorded_periods = 0;
+	played_periods = 0;
+	loop_period = 0;
+
+#if PIPELINE_BEAMFORMING
+	beamformer.reset();
+#endif
+
+#if PIPELINE_PREPROCESS
+	preprocessor.reset();
+#endif
+
+#if PIPELINE_GATE
+	gate.reset();
+#endif
+}
+
+/*
+ * Select which of the buffers is processed. When listening starts, the
+ * periods recorded meanwhile are skipped rather than replayed, and the ones
+ * the gate kept from before are dropped.
+ */
+void pipeline_set_mode(pipeline_mode_t new_mode)
+{
+	if (new_mode == PIPELINE_LISTENING && settings.hal->recorded_count)
+		decoded_periods = settings.hal->recorded_count();
+
+#if PIPELINE_GATE
+	if (new_mode == PIPELINE_LISTENING)
+		gate.discard();
+#endif
+
+	mode = new_mode;
+}
+
+pipeline_mode_t pipeline_get_mode(void)
+{
+	return mode;
+}
+
+/*
+ * Frames by which the second microphone currently hears the audio before
+ * the first one, 0 without beamforming.
+ */
+int pipeline_beam_delay(void)
+{
+#if PIPELINE_BEAMFORMING
+	return beamformer.delay();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Band-pass the decoded audio between `low` and `high` Hz, the codec running
+ * at `sample_rate`. The band set is kept by `pipeline_init()`. Returns false
+ * if the band is empty or pre-processing is not built in.
+ */
+bool pipeline_set_band(float low, float high, uint32_t sample_rate)
+{
+#if PIPELINE_PREPROCESS
+	return preprocessor.set_band(low, high, (float) sample_rate / PIPELINE_DECIMATION);
+#else
+	(void) low;
+	(void) high;
+	(void) sample_rate;
+	return false;
+#endif
+}
+
+/*
+ * Same as `pipeline_set_band()` with the band of the protocol named in
+ * `info`, as returned by `chirp_sdk_get_info()`. Returns false for unknown
+ * protocols, the audio is then only levelled.
+ */
+bool pipeline_set_band_from_info(const char *info, uint32_t sample_rate)
+{
+#if PIPELINE_PREPROCESS
+	for (const auto &band : bands)
+	{
+		if (strstr(info, band.name))
+			return pipeline_set_band(band.low, band.high, sample_rate);
+	}
+#else
+	(void) info;
+	(void) sample_rate;
+#endif
+
+	return false;
+}
+
+/*
+ * Bypass the pre-processing, for instance to compare the decode rates.
+ */
+void pipeline_set_preprocess(bool enable)
+{
+#if PIPELINE_PREPROCESS
+	preprocessor.enable(enable);
+#else
+	(void) enable;
+#endif
+}
+
+/*
+ * Gain applied to the last period by the gain control.
+ */
+float pipeline_gain(void)
+{
+#if PIPELINE_PREPROCESS
+	return preprocessor.gain();
+#else
+	return 1.0f;
+#endif
+}
+
+/*
+ * Give every period to the application, for instance to compare the decode
+ * rates. The gate is open while the pipeline is built without it.
+ */
+void pipeline_set_gate(bool enable)
+{
+#if PIPELINE_GATE
+	gate.enable(enable);
+#else
+	(void) enable;
+#endif
+}
+
+/*
+ * Periods kept from the application by the gate since the start.
+ */
+uint32_t pipeline_skipped_periods(void)
+{
+#if PIPELINE_GATE
+	return gate.skipped();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Position in the audio, in samples given to the SDK, of the first sample of
+ * the period being given to `loop`: the period recorded, or the period which
+ * will be played, counted since the start of the audio. The periods replayed
+ * or kept by the gate get the position they were recorded at, so it follows
+ * the audio rather than the time the SDK sees it. Wraps every 27 hours at
+ * 44.1kHz.
+ */
+uint32_t pipeline_position(void)
+{
+	return loop_period * period_t::length;
+}
+
+/*
+ * Called from the audio interrupt once the `half` of the record buffer, 0
+ * for the first one, has been filled.
+ */
+void pipeline_recorded(uint8_t half)
+{
+	uint32_t offset = half ? period_t::samples : 0;
+
+	record_offset = offset;
+	record_state = half ? BUFFER_STATE_FULL : BUFFER_STATE_HALF;
+	recorded_periods++;
+
+	if (settings.hal->recorded)
+		settings.hal->recorded(&settings.record_buffer[offset]);
+}
+
+/*
+ * Called from the audio interrupt once the `half` of the play buffer, 0 for
+ * the first one, has been sent and can be filled again.
+ */
+void pipeline_played(uint8_t half)
+{
+	play_offset = half ? period_t::samples : 0;
+	play_state = half ? BUFFER_STATE_FULL : BUFFER_STATE_HALF;
+	played_periods++;
+}
+
+/*
+ * Whether an audio period is ready to be processed.
+ */
+bool pipeline_pending(void)
+{
+	if (mode == PIPELINE_LISTENING)
+		return record_state != BUFFER_STATE_EMPTY;
+
+	if (mode == PIPELINE_PLAYING)
+		return play_state != BUFFER_STATE_EMPTY;
+
+	return false;
+}
+
+/*
+ * Called in the main loop. Whenever some samples are ready to be played or
+ * analysed, a float buffer is sent to the application `loop` function.
+ */
+PIPELINE_TEXT void pipeline_process(void)
+{
+	if (!pipeline_pending())
+		return;
+
+	if (mode == PIPELINE_LISTENING)
+		listen();
+	else
+		play();
+
+	if (settings.hal->processed)
+		settings.hal->processed();
+}
@@ -0,0 +1,386 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file telemetry.c
+ *
+ *  @brief Status records of the example: the SDK events and payloads, the
+ *  CPU load, the core clock and the memory usage. By default they are
+ *  printed on the serial line as before, the memory usage as CSV, to size
+ *  the stack, the arena and the buffers for a given config rather than
+ *  guessing. Every memory record holds:
+ *
+ *  - the stack high-water mark, found by looking for the lowest word of the
+ *    stack no longer holding the pattern painted by the startup code,
+ *  - the highest break reached by `_sbrk()`,
+ *  - the current and peak usage of the arena backing malloc(),
+ *  - the heap usage reported by the SDK, current and highest sampled.
+ *
+ *  Built with `make BINARY_TELEMETRY=1`, the records are rather sent as
+ *  binary frames, a few times shorter than the lines and never formatted.
+ *  Every frame is an 8 bytes header, type, body length, sequence number and
+ *  time in milliseconds, then the body, padded to 32 bits words, then the
+ *  CRC-32 of all of it computed by the CRC unit of the board. It is COBS
+ *  encoded and sent between two zero bytes, which the text still printed
+ *  never holds. The frames are queued and sent from the interrupt of the
+ *  serial line, the main loop never waits for it. All values are little
+ *  endian, see tools/telemetry_decode.py for the bodies.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "telemetry.h"
+
+// Number of audio periods between two memory records.
+#define TELEMETRY_PERIODS	500
+
+// Value the startup code fills the stack with.
+#define TELEMETRY_STACK_PATTERN	0xefbeadde
+
+#define HEADER_SIZE		8
+#define MAX_BODY_SIZE	(2 + TELEMETRY_MAX_PAYLOAD)
+#define MAX_FRAME_SIZE	(HEADER_SIZE + ((MAX_BODY_SIZE + 3) & ~3) + 4)
+// One code byte every 254 bytes, and the two delimiters.
+#define MAX_ENCODED_SIZE	(MAX_FRAME_SIZE + MAX_FRAME_SIZE / 254 + 1 + 2)
+
+// Defined by the linker script.
+extern uint32_t _estack[];
+extern uint8_t _Stack_Size[];
+extern char end[];
+
+// Defined in syscalls.c.
+extern char *sbrk_peak;
+
+static chirp_sdk_t *telemetry_sdk = NULL;
+static const telemetry_link_t *telemetry_link = NULL;
+
+static uint32_t periods = 0;
+static uint32_t records = 0;
+static int32_t sdk_heap_peak = 0;
+
+#if BINARY_TELEMETRY
+// Written by the main loop at `queue_head`, sent from `queue_tail` by the
+// interrupt of the serial line, both counting bytes since the start.
+static uint8_t queue[TELEMETRY_QUEUE_SIZE];
+static uint32_t queue_head = 0;
+static uint32_t queue_tail = 0;
+static uint32_t in_flight = 0;
+static volatile bool sending = false;
+
+static uint16_t sequence = 0;
+static uint32_t dropped = 0;
+#endif
+
+/*
+ * Deepest the stack has been since boot, in bytes. The stack grows down, so
+ * the painted words left at its bottom have never been used.
+ */
+static uint32_t stack_peak(void)
+{
+	uint32_t size = (uint32_t) _Stack_Size;
+	uint32_t *bottom = _estack - size / sizeof(uint32_t);
+	uint32_t *word = bottom;
+
+	while (word < _estack && *word == TELEMETRY_STACK_PATTERN)
+		word++;
+
+	return (uint32_t) (_estack - word) * sizeof(uint32_t);
+}
+
+#if BINARY_TELEMETRY
+
+static uint8_t *put_u16(uint8_t *data, uint16_t value)
+{
+	data[0] = value & 0xFF;
+	data[1] = value >> 8;
+	return data + 2;
+}
+
+static uint8_t *put_u32(uint8_t *data, uint32_t value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = value >> 24;
+	return data + 4;
+}
+
+/*
+ * Send the longest run of bytes queued which does not wrap around, if any.
+ * Called with the serial line idle.
+ */
+static void transmit_queued(void)
+{
+	uint32_t tail = queue_tail;
+	uint32_t waiting = __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE) - tail;
+	uint32_t offset = tail % TELEMETRY_QUEUE_SIZE;
+
+	if (waiting == 0)
+	{
+		sending = false;
+		return;
+	}
+
+	in_flight = waiting < TELEMETRY_QUEUE_SIZE - offset ? waiting : TELEMETRY_QUEUE_SIZE - offset;
+	sending = true;
+
+	if (!telemetry_link->transmit(&queue[offset], in_flight))
+	{
+		// The line is busy with text, the next record retries.
+		in_flight = 0;
+		sending = false;
+	}
+}
+
+/*
+ * COBS encode `size` bytes into `encoded`, between two zero bytes. Returns
+ * the size encoded.
+ */
+static size_t encode(const uint8_t *data, size_t size, uint8_t *encoded)
+{
+	uint8_t *out = encoded;
+	*out++ = 0;
+
+	uint8_t *code = out++;
+	*code = 1;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (data[i] != 0)
+		{
+			*out++ = data[i];
+			(*code)++;
+		}
+
+		if (data[i] == 0 || *code == 0xFF)
+		{
+			code = out++;
+			*code = 1;
+		}
+	}
+
+	*out++ = 0;
+
+	return out - encoded;
+}
+
+/*
+ * Frame the record, `body` bytes already written after the header of
+ * `frame`, and queue it. Dropped if the queue is full.
+ */
+static void send(telemetry_type_t type, uint32_t frame[], size_t body)
+{
+	if (telemetry_link == NULL)
+		return;
+
+	uint8_t *data = (uint8_t *) frame;
+	size_t words = (HEADER_SIZE + body + 3) / 4;
+
+	data[0] = type;
+	data[1] = body;
+	put_u16(&data[2], sequence++);
+	put_u32(&data[4], telemetry_link->time());
+	memset(&data[HEADER_SIZE + body], 0, words * 4 - HEADER_SIZE - body);
+
+	put_u32((uint8_t *) &frame[words], telemetry_link->crc(frame, words));
+
+	uint8_t encoded[MAX_ENCODED_SIZE];
+	size_t size = encode(data, (words + 1) * 4, encoded);
+
+	uint32_t head = queue_head;
+	if (head - __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE) + size > TELEMETRY_QUEUE_SIZE)
+	{
+		dropped++;
+		return;
+	}
+
+	for (size_t i = 0; i < size; i++)
+		queue[(head + i) % TELEMETRY_QUEUE_SIZE] = encoded[i];
+
+	__atomic_store_n(&queue_head, head + size, __ATOMIC_RELEASE);
+
+	// Only started here while the line is idle, the interrupt goes on with
+	// whatever was queued meanwhile.
+	if (!sending)
+		transmit_queued();
+}
+
+#endif
+
+/*
+ * Called from the interrupt of the serial line once the bytes given to
+ * `transmit` are sent, goes on with the ones queued meanwhile.
+ */
+void telemetry_transmitted(void)
+{
+#if BINARY_TELEMETRY
+	__atomic_store_n(&queue_tail, queue_tail + in_flight, __ATOMIC_RELEASE);
+	in_flight = 0;
+
+	transmit_queued();
+#endif
+}
+
+/*
+ * Start the records, printing the CSV header or sending the boot record.
+ * Must be called once the SDK has been created.
+ */
+void telemetry_init(chirp_sdk_t *sdk, const telemetry_link_t *link)
+{
+	telemetry_sdk = sdk;
+	telemetry_link = link;
+
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+
+	body[0] = TELEMETRY_VERSION;
+	put_u32(&body[1], (uint32_t) _Stack_Size);
+	send(TELEMETRY_BOOT, frame, 5);
+#else
+	printf("telemetry,record,stack_peak,stack_size,sbrk_peak,arena_used,arena_peak,arena_size,sdk_heap,sdk_heap_peak\n");
+#endif
+}
+
+/*
+ * Called once an audio period has been processed, reports the memory usage
+ * every `TELEMETRY_PERIODS` periods.
+ */
+void telemetry_period(void)
+{
+	if (telemetry_sdk == NULL || ++periods < TELEMETRY_PERIODS)
+		return;
+
+	periods = 0;
+
+	int32_t sdk_heap = chirp_sdk_get_heap_usage(telemetry_sdk);
+	if (sdk_heap > sdk_heap_peak)
+		sdk_heap_peak = sdk_heap;
+
+	arena_stats_t arena;
+	arena_get_stats(&arena);
+
+	uint32_t sbrk_bytes = sbrk_peak != NULL ? (uint32_t) (sbrk_peak - end) : 0;
+
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+	uint8_t *field = body;
+
+	field = put_u32(field, records++);
+	field = put_u32(field, stack_peak());
+	field = put_u32(field, (uint32_t) _Stack_Size);
+	field = put_u32(field, sbrk_bytes);
+	field = put_u32(field, arena.used);
+	field = put_u32(field, arena.peak);
+	field = put_u32(field, arena.size);
+	field = put_u32(field, sdk_heap);
+	field = put_u32(field, sdk_heap_peak);
+	// Frames the queue could not take so far.
+	field = put_u32(field, dropped);
+	send(TELEMETRY_MEMORY, frame, field - body);
+#else
+	printf("telemetry,%lu,%lu,%lu,%lu,%u,%u,%u,%ld,%ld\n",
+			records++, stack_peak(), (uint32_t) _Stack_Size, sbrk_bytes,
+			arena.used, arena.peak, arena.size, sdk_heap, sdk_heap_peak);
+#endif
+}
+
+/*
+ * Called from the state changed callback of the SDK, only sent in binary.
+ */
+void telemetry_state(chirp_sdk_state_t old_state, chirp_sdk_state_t new_state)
+{
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+
+	body[0] = old_state;
+	body[1] = new_state;
+	send(TELEMETRY_STATE, frame, 2);
+#endif
+}
+
+/*
+ * Called from the sending, sent, receiving and received callbacks of the
+ * SDK, `type` telling which. A NULL payload received is a failed decode.
+ * In text, only the receptions are printed.
+ */
+void telemetry_payload(telemetry_type_t type, const uint8_t *payload, size_t length, uint8_t channel)
+{
+	if (payload == NULL)
+		length = 0;
+
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+	size_t kept = length < TELEMETRY_MAX_PAYLOAD ? length : TELEMETRY_MAX_PAYLOAD;
+
+	body[0] = channel;
+	body[1] = length;
+	if (kept)
+		memcpy(&body[2], payload, kept);
+	send(type, frame, 2 + kept);
+#else
+	if (type == TELEMETRY_RECEIVING)
+	{
+		printf("Receiving data.\n");
+	}
+	else if (type == TELEMETRY_RECEIVED && length)
+	{
+		printf("Received: ");
+		for (size_t i = 0; i < length; i++)
+			printf("%02x", payload[i]);
+		printf("\n");
+	}
+#endif
+}
+
+/*
+ * CPU load over the last report, as shares of an audio period, see idle.c.
+ */
+void telemetry_load(float average, float peak, uint32_t peak_cycles, uint32_t period_cycles)
+{
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+	uint8_t *field = body;
+
+	// In hundredths of a percent.
+	field = put_u16(field, (uint16_t) (10000.0f * average + 0.5f));
+	field = put_u16(field, (uint16_t) (10000.0f * peak + 0.5f));
+	field = put_u32(field, peak_cycles);
+	field = put_u32(field, period_cycles);
+	send(TELEMETRY_LOAD, frame, field - body);
+#else
+	printf("CPU load: %.1f%% average, %.1f%% peak (%lu of %lu cycles per period).\n",
+			100.0f * average, 100.0f * peak, peak_cycles, period_cycles);
+#endif
+}
+
+/*
+ * Core clock set by the governor, in Hz, and the peak cycles per period
+ * measured in each state of the SDK, see governor.c.
+ */
+void telemetry_clock(uint32_t frequency, uint32_t running_peak, uint32_t sending_peak, uint32_t receiving_peak)
+{
+#if BINARY_TELEMETRY
+	uint32_t frame[MAX_FRAME_SIZE / 4];
+	uint8_t *body = (uint8_t *) frame + HEADER_SIZE;
+	uint8_t *field = body;
+
+	field = put_u32(field, frequency);
+	field = put_u32(field, running_peak);
+	field = put_u32(field, sending_peak);
+	field = put_u32(field, receiving_peak);
+	send(TELEMETRY_CLOCK, frame, field - body);
+#else
+	printf("Core clock: %lu MHz (peak cycles per period: running %lu, sending %lu, receiving %lu).\n",
+			frequency / 1000000, running_peak, sending_peak, receiving_peak);
+#endif
+}
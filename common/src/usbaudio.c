@@ -0,0 +1,508 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file usbaudio.c
+ *
+ *  @brief USB Audio Class 1.0 sound card streaming to a host the audio the
+ *  SDK is given to decode, on the left channel, and the audio it synthesises,
+ *  on the right one, as the 32 bits floats of the float buffer, so that a
+ *  session recorded on the host can be fed back to the decoder bit for bit.
+ *
+ *  The main loop writes the periods to a ring and never waits for the USB:
+ *  once the ring is full, frames are dropped and counted. The interrupt of
+ *  the USB device sends the frames waiting, up to `USBAUDIO_MAX_PACKET_FRAMES`
+ *  a millisecond, from two packet buffers used in turn so that one is filled
+ *  while the other is sent. The isochronous endpoint is asynchronous: the
+ *  board is the clock of the stream, the size of every packet tells the host
+ *  how many frames it holds, and no feedback endpoint is needed. Only the
+ *  periods given to the SDK are sent, the ones skipped by the gate are not.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "usbaudio.h"
+
+#define LO(value)	((uint8_t) ((value) & 0xFF))
+#define HI(value)	((uint8_t) (((value) >> 8) & 0xFF))
+
+// Standard requests and descriptors, USB 2.0 chapter 9.
+#define REQUEST_GET_STATUS			0x00
+#define REQUEST_CLEAR_FEATURE		0x01
+#define REQUEST_SET_FEATURE			0x03
+#define REQUEST_SET_ADDRESS			0x05
+#define REQUEST_GET_DESCRIPTOR		0x06
+#define REQUEST_GET_CONFIGURATION	0x08
+#define REQUEST_SET_CONFIGURATION	0x09
+#define REQUEST_GET_INTERFACE		0x0A
+#define REQUEST_SET_INTERFACE		0x0B
+
+#define REQUEST_TYPE_MASK			0x60
+#define REQUEST_TYPE_STANDARD		0x00
+
+#define DESCRIPTOR_DEVICE			0x01
+#define DESCRIPTOR_CONFIGURATION	0x02
+#define DESCRIPTOR_STRING			0x03
+#define DESCRIPTOR_INTERFACE		0x04
+#define DESCRIPTOR_ENDPOINT			0x05
+#define DESCRIPTOR_CS_INTERFACE		0x24
+#define DESCRIPTOR_CS_ENDPOINT		0x25
+
+#define STRING_MANUFACTURER			1
+#define STRING_PRODUCT				2
+
+#define CONTROL_INTERFACE			0
+#define STREAMING_INTERFACE			1
+#define INPUT_TERMINAL				1
+#define OUTPUT_TERMINAL				2
+
+#define CONTROL_SIZE				(9 + 12 + 9)
+#define CONFIGURATION_SIZE			(9 + 9 + CONTROL_SIZE + 9 + 9 + 7 + 11 + 9 + 7)
+// Offset of the sample rate in the configuration descriptor.
+#define SAMPLE_RATE_OFFSET			(9 + 9 + CONTROL_SIZE + 9 + 9 + 7 + 8)
+
+#define RING_SAMPLES				(USBAUDIO_RING_FRAMES * USBAUDIO_CHANNELS)
+
+static const uint8_t device_descriptor[] = {
+	18, DESCRIPTOR_DEVICE,
+	LO(0x0200), HI(0x0200),
+	// Class given by the interfaces.
+	0x00, 0x00, 0x00,
+	USBAUDIO_EP0_SIZE,
+	LO(USBAUDIO_VENDOR_ID), HI(USBAUDIO_VENDOR_ID),
+	LO(USBAUDIO_PRODUCT_ID), HI(USBAUDIO_PRODUCT_ID),
+	LO(0x0100), HI(0x0100),
+	STRING_MANUFACTURER, STRING_PRODUCT, 0,
+	1,
+};
+
+static uint8_t configuration_descriptor[CONFIGURATION_SIZE] = {
+	9, DESCRIPTOR_CONFIGURATION,
+	LO(CONFIGURATION_SIZE), HI(CONFIGURATION_SIZE),
+	2, 1, 0,
+	// Bus powered, 100mA.
+	0x80, 50,
+
+	// Audio control interface, no control.
+	9, DESCRIPTOR_INTERFACE, CONTROL_INTERFACE, 0, 0, 0x01, 0x01, 0x00, 0,
+	9, DESCRIPTOR_CS_INTERFACE, 0x01, LO(0x0100), HI(0x0100), LO(CONTROL_SIZE), HI(CONTROL_SIZE),
+	1, STREAMING_INTERFACE,
+	// Stereo microphone.
+	12, DESCRIPTOR_CS_INTERFACE, 0x02, INPUT_TERMINAL, LO(0x0201), HI(0x0201), 0,
+	USBAUDIO_CHANNELS, LO(0x0003), HI(0x0003), 0, 0,
+	// USB streaming.
+	9, DESCRIPTOR_CS_INTERFACE, 0x03, OUTPUT_TERMINAL, LO(0x0101), HI(0x0101), 0, INPUT_TERMINAL, 0,
+
+	// Audio streaming interface, no endpoint until the host starts streaming.
+	9, DESCRIPTOR_INTERFACE, STREAMING_INTERFACE, 0, 0, 0x01, 0x02, 0x00, 0,
+	9, DESCRIPTOR_INTERFACE, STREAMING_INTERFACE, 1, 1, 0x01, 0x02, 0x00, 0,
+	// IEEE float, one frame of delay.
+	7, DESCRIPTOR_CS_INTERFACE, 0x01, OUTPUT_TERMINAL, 1, LO(0x0003), HI(0x0003),
+	// Type I, 4 bytes a sample, a single sample rate set by `usbaudio_init()`.
+	11, DESCRIPTOR_CS_INTERFACE, 0x02, 0x01, USBAUDIO_CHANNELS, sizeof(float), 32, 1, 0, 0, 0,
+	// Isochronous, asynchronous, every millisecond.
+	9, DESCRIPTOR_ENDPOINT, USBAUDIO_STREAM_EP, 0x05,
+	LO(USBAUDIO_STREAM_EP_SIZE), HI(USBAUDIO_STREAM_EP_SIZE), 1, 0, 0,
+	7, DESCRIPTOR_CS_ENDPOINT, 0x01, 0x00, 0, 0, 0,
+};
+
+static const char manufacturer[] = "Asio Ltd";
+static const char *product = "Chirp";
+
+static const usbaudio_device_t *device = NULL;
+
+static uint8_t configuration = 0;
+
+// Rest of the data stage of a control transfer, and whether it ends with
+// an empty packet.
+static uint8_t ep0_buffer[USBAUDIO_EP0_SIZE * 2];
+static const uint8_t *ep0_data = NULL;
+static size_t ep0_remaining = 0;
+static bool ep0_zlp = false;
+static bool ep0_in = false;
+
+// Written by the main loop from `write_frame`, read by the interrupt from
+// `read_frame`, both counting frames since the stream started.
+static float ring[RING_SAMPLES];
+static uint32_t write_frame = 0;
+static uint32_t read_frame = 0;
+static volatile bool streaming = false;
+static bool reported = false;
+
+static float packets[2][USBAUDIO_MAX_PACKET_FRAMES * USBAUDIO_CHANNELS];
+static uint8_t packet_index = 0;
+static size_t packet_size = 0;
+
+static usbaudio_stats_t stats;
+
+/*
+ * `product` names the sound card on the host and must outlive the stream.
+ */
+void usbaudio_init(const usbaudio_device_t *usb_device, uint32_t sample_rate, const char *product_name)
+{
+	device = usb_device;
+	product = product_name;
+
+	configuration_descriptor[SAMPLE_RATE_OFFSET] = sample_rate & 0xFF;
+	configuration_descriptor[SAMPLE_RATE_OFFSET + 1] = (sample_rate >> 8) & 0xFF;
+	configuration_descriptor[SAMPLE_RATE_OFFSET + 2] = (sample_rate >> 16) & 0xFF;
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+/*
+ * Called from the main loop with every period given to the SDK, `decoded`
+ * as it was given and `played` as the SDK left it, either NULL for silence.
+ * Never waits.
+ */
+void usbaudio_write(const float *decoded, const float *played, size_t frames)
+{
+	if (!streaming)
+		return;
+
+	uint32_t write = write_frame;
+	uint32_t read = __atomic_load_n(&read_frame, __ATOMIC_ACQUIRE);
+
+	for (size_t i = 0; i < frames; i++)
+	{
+		if (write - read >= USBAUDIO_RING_FRAMES)
+		{
+			stats.dropped += frames - i;
+			break;
+		}
+
+		float *frame = &ring[(write % USBAUDIO_RING_FRAMES) * USBAUDIO_CHANNELS];
+		frame[0] = decoded ? decoded[i] : 0.0f;
+		frame[1] = played ? played[i] : 0.0f;
+		write++;
+	}
+
+	if (write - read > stats.peak)
+		stats.peak = write - read;
+
+	__atomic_store_n(&write_frame, write, __ATOMIC_RELEASE);
+}
+
+/*
+ * Whether the host is recording from the sound card.
+ */
+bool usbaudio_streaming(void)
+{
+	return streaming;
+}
+
+/*
+ * Called from the main loop, reports when the host starts or stops
+ * recording.
+ */
+void usbaudio_process(void)
+{
+	bool now = streaming;
+	if (now == reported)
+		return;
+
+	reported = now;
+
+	if (now)
+		printf("USB audio streaming.\n");
+	else
+		printf("USB audio stopped: %lu frames sent, %lu dropped, %lu packets missed, %lu frames waiting at most.\n",
+				(unsigned long) stats.frames, (unsigned long) stats.dropped, (unsigned long) stats.missed,
+				(unsigned long) stats.peak);
+}
+
+void usbaudio_get_stats(usbaudio_stats_t *out)
+{
+	*out = stats;
+}
+
+/*
+ * Fill the packet buffer not being sent with the frames waiting, possibly
+ * none, and send it in the next frame.
+ */
+static void send_packet(void)
+{
+	uint32_t read = read_frame;
+	uint32_t waiting = __atomic_load_n(&write_frame, __ATOMIC_ACQUIRE) - read;
+	uint32_t count = waiting < USBAUDIO_MAX_PACKET_FRAMES ? waiting : USBAUDIO_MAX_PACKET_FRAMES;
+
+	packet_index ^= 1;
+	float *packet = packets[packet_index];
+
+	for (uint32_t i = 0; i < count; i++, read++)
+		memcpy(&packet[i * USBAUDIO_CHANNELS], &ring[(read % USBAUDIO_RING_FRAMES) * USBAUDIO_CHANNELS],
+				USBAUDIO_CHANNELS * sizeof(float));
+
+	__atomic_store_n(&read_frame, read, __ATOMIC_RELEASE);
+
+	packet_size = count * USBAUDIO_CHANNELS * sizeof(float);
+	stats.frames += count;
+
+	device->transmit(USBAUDIO_STREAM_EP, packet, packet_size);
+}
+
+static void start_streaming(void)
+{
+	read_frame = write_frame;
+	device->open(USBAUDIO_STREAM_EP, USBAUDIO_STREAM_EP_SIZE, true);
+	streaming = true;
+	send_packet();
+}
+
+static void stop_streaming(void)
+{
+	if (!streaming)
+		return;
+
+	streaming = false;
+	device->flush(USBAUDIO_STREAM_EP);
+	device->close(USBAUDIO_STREAM_EP);
+}
+
+static void stall(void)
+{
+	device->stall(0x80);
+	device->stall(0x00);
+}
+
+static void send_status(void)
+{
+	ep0_in = false;
+	device->transmit(0x80, NULL, 0);
+}
+
+/*
+ * Send the next packet of the data stage, or wait for the status stage.
+ */
+static void continue_data(void)
+{
+	if (ep0_remaining > 0 || ep0_zlp)
+	{
+		size_t size = ep0_remaining < USBAUDIO_EP0_SIZE ? ep0_remaining : USBAUDIO_EP0_SIZE;
+
+		if (size < USBAUDIO_EP0_SIZE)
+			ep0_zlp = false;
+
+		device->transmit(0x80, ep0_data, size);
+		ep0_data += size;
+		ep0_remaining -= size;
+		return;
+	}
+
+	ep0_in = false;
+	device->receive(0x00, NULL, 0);
+}
+
+static void send_data(const void *data, size_t size, uint16_t requested)
+{
+	if (size > requested)
+		size = requested;
+
+	ep0_data = data;
+	ep0_remaining = size;
+	// A data stage shorter than requested ending on a full packet needs an
+	// empty one to end it.
+	ep0_zlp = size < requested && size % USBAUDIO_EP0_SIZE == 0;
+	ep0_in = true;
+
+	continue_data();
+}
+
+static size_t string_descriptor(uint8_t index, uint8_t *buffer)
+{
+	const char *string;
+
+	if (index == 0)
+	{
+		// English (United States) only.
+		buffer[0] = 4;
+		buffer[1] = DESCRIPTOR_STRING;
+		buffer[2] = LO(0x0409);
+		buffer[3] = HI(0x0409);
+		return 4;
+	}
+	else if (index == STRING_MANUFACTURER)
+		string = manufacturer;
+	else if (index == STRING_PRODUCT)
+		string = product;
+	else
+		return 0;
+
+	size_t length = strlen(string);
+	if (length > sizeof(ep0_buffer) / 2 - 1)
+		length = sizeof(ep0_buffer) / 2 - 1;
+
+	buffer[0] = 2 + 2 * length;
+	buffer[1] = DESCRIPTOR_STRING;
+	for (size_t i = 0; i < length; i++)
+	{
+		buffer[2 + 2 * i] = string[i];
+		buffer[3 + 2 * i] = 0;
+	}
+
+	return buffer[0];
+}
+
+static void get_descriptor(uint16_t value, uint16_t length)
+{
+	switch (value >> 8)
+	{
+		case DESCRIPTOR_DEVICE:
+			send_data(device_descriptor, sizeof(device_descriptor), length);
+			break;
+
+		case DESCRIPTOR_CONFIGURATION:
+			send_data(configuration_descriptor, sizeof(configuration_descriptor), length);
+			break;
+
+		case DESCRIPTOR_STRING:
+		{
+			size_t size = string_descriptor(value & 0xFF, ep0_buffer);
+			if (size)
+				send_data(ep0_buffer, size, length);
+			else
+				stall();
+			break;
+		}
+
+		default:
+			// Full speed only, no device qualifier.
+			stall();
+			break;
+	}
+}
+
+static void set_interface(uint16_t interface, uint16_t alternate)
+{
+	if (interface != STREAMING_INTERFACE || alternate > 1)
+	{
+		stall();
+		return;
+	}
+
+	if (alternate == 1)
+	{
+		stop_streaming();
+		start_streaming();
+	}
+	else
+		stop_streaming();
+
+	send_status();
+}
+
+/*
+ * Called on a bus reset, before the host enumerates the device again.
+ */
+void usbaudio_reset(void)
+{
+	streaming = false;
+	configuration = 0;
+	ep0_in = false;
+
+	device->open(0x00, USBAUDIO_EP0_SIZE, false);
+	device->open(0x80, USBAUDIO_EP0_SIZE, false);
+}
+
+/*
+ * Called with the 8 bytes of every setup packet received on endpoint 0.
+ */
+void usbaudio_setup(const uint8_t *setup)
+{
+	uint8_t type = setup[0];
+	uint8_t request = setup[1];
+	uint16_t value = setup[2] | (setup[3] << 8);
+	uint16_t index = setup[4] | (setup[5] << 8);
+	uint16_t length = setup[6] | (setup[7] << 8);
+
+	// The sound card has no control, class requests are refused.
+	if ((type & REQUEST_TYPE_MASK) != REQUEST_TYPE_STANDARD)
+	{
+		stall();
+		return;
+	}
+
+	switch (request)
+	{
+		case REQUEST_GET_STATUS:
+			memset(ep0_buffer, 0, 2);
+			send_data(ep0_buffer, 2, length);
+			break;
+
+		case REQUEST_CLEAR_FEATURE:
+		case REQUEST_SET_FEATURE:
+			send_status();
+			break;
+
+		case REQUEST_SET_ADDRESS:
+			device->set_address(value & 0x7F);
+			send_status();
+			break;
+
+		case REQUEST_GET_DESCRIPTOR:
+			get_descriptor(value, length);
+			break;
+
+		case REQUEST_GET_CONFIGURATION:
+			ep0_buffer[0] = configuration;
+			send_data(ep0_buffer, 1, length);
+			break;
+
+		case REQUEST_SET_CONFIGURATION:
+			if (value > 1)
+			{
+				stall();
+				break;
+			}
+			stop_streaming();
+			configuration = value;
+			send_status();
+			break;
+
+		case REQUEST_GET_INTERFACE:
+			ep0_buffer[0] = index == STREAMING_INTERFACE && streaming ? 1 : 0;
+			send_data(ep0_buffer, 1, length);
+			break;
+
+		case REQUEST_SET_INTERFACE:
+			set_interface(index, value);
+			break;
+
+		default:
+			stall();
+			break;
+	}
+
+}
+
+/*
+ * Called once a packet has been sent on an IN endpoint.
+ */
+void usbaudio_in_complete(uint8_t endpoint)
+{
+	if (endpoint == 0x80)
+	{
+		if (ep0_in)
+			continue_data();
+	}
+	else if (endpoint == USBAUDIO_STREAM_EP && streaming)
+		send_packet();
+}
+
+/*
+ * Called when the host did not collect the packet of the stream in its
+ * frame, the packet is sent again in the next one.
+ */
+void usbaudio_in_incomplete(uint8_t endpoint)
+{
+	if (endpoint != USBAUDIO_STREAM_EP || !streaming)
+		return;
+
+	stats.missed++;
+
+	device->flush(USBAUDIO_STREAM_EP);
+	device->transmit(USBAUDIO_STREAM_EP, packets[packet_index], packet_size);
+}
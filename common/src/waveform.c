@@ -0,0 +1,360 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file waveform.c
+ *
+ *  @brief Cache of the audio of the payloads sent, so that the ones sent
+ *  over and over are only synthesised by the SDK once. The first time a
+ *  payload is sent, every period played until the SDK is done is copied to
+ *  the storage, as interleaved 16 bits samples ready for the play buffer.
+ *  The next times, the periods are copied back into the play buffer and the
+ *  SDK is not called at all.
+ *
+ *  The storage, typically external SDRAM, is split into blocks of a period
+ *  linked into one list per payload, so that payloads of any length share it
+ *  without fragmenting it. When it is full, the payloads used the longest ago
+ *  are evicted. Whatever changes the audio synthesised, such as the volume or
+ *  the config, must invalidate the cache.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "waveform.h"
+
+#define NO_BLOCK	0xFFFF
+
+typedef struct {
+	uint8_t payload[WAVEFORM_MAX_PAYLOAD];
+	// 0 for an entry not in use.
+	uint8_t length;
+	// Set once the last period has been recorded.
+	bool complete;
+	uint16_t first;
+	uint16_t last;
+	uint16_t count;
+	// Value of `uses` when last played or recorded.
+	uint32_t used;
+} entry_t;
+
+static uint8_t *storage = NULL;
+static size_t block_size = 0;
+static uint16_t block_count = 0;
+static waveform_copy_t copy = NULL;
+
+// Next block of each block, in the list of a payload or the free list.
+static uint16_t links[WAVEFORM_MAX_BLOCKS];
+static uint16_t free_first = NO_BLOCK;
+static uint16_t free_count = 0;
+
+static entry_t entries[WAVEFORM_MAX_ENTRIES];
+static uint32_t uses = 0;
+
+static entry_t *recording = NULL;
+// Set once the SDK is done, the period being played is the last one.
+static bool closing = false;
+
+static entry_t *playing = NULL;
+static uint16_t play_block = NO_BLOCK;
+static uint16_t play_remaining = 0;
+
+static waveform_stats_t stats;
+
+static void *block_address(uint16_t block)
+{
+	return storage + (size_t) block * block_size;
+}
+
+static void copy_block(void *destination, const void *source)
+{
+	if (copy)
+		copy(destination, source, block_size);
+	else
+		memcpy(destination, source, block_size);
+}
+
+/*
+ * Give the blocks of `entry` back to the free list and forget it.
+ */
+static void release(entry_t *entry)
+{
+	if (entry->count > 0)
+	{
+		links[entry->last] = free_first;
+		free_first = entry->first;
+		free_count += entry->count;
+	}
+
+	if (entry->complete)
+		stats.entries--;
+
+	entry->length = 0;
+	entry->complete = false;
+	entry->count = 0;
+
+	if (entry == recording)
+		recording = NULL;
+	if (entry == playing)
+		playing = NULL;
+}
+
+/*
+ * Release the complete entry used the longest ago, except the one being
+ * played. Returns false if there is none.
+ */
+static bool evict(void)
+{
+	entry_t *oldest = NULL;
+
+	for (size_t i = 0; i < WAVEFORM_MAX_ENTRIES; i++)
+	{
+		entry_t *entry = &entries[i];
+		if (!entry->complete || entry == playing)
+			continue;
+
+		if (oldest == NULL || uses - entry->used > uses - oldest->used)
+			oldest = entry;
+	}
+
+	if (oldest == NULL)
+		return false;
+
+	release(oldest);
+	stats.evictions++;
+	return true;
+}
+
+static uint16_t allocate_block(void)
+{
+	while (free_count == 0)
+	{
+		if (!evict())
+			return NO_BLOCK;
+	}
+
+	uint16_t block = free_first;
+	free_first = links[block];
+	free_count--;
+	links[block] = NO_BLOCK;
+
+	return block;
+}
+
+static entry_t *find(const uint8_t *payload, size_t length)
+{
+	for (size_t i = 0; i < WAVEFORM_MAX_ENTRIES; i++)
+	{
+		entry_t *entry = &entries[i];
+		if (entry->length == length && memcmp(entry->payload, payload, length) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static entry_t *unused_entry(void)
+{
+	for (size_t i = 0; i < WAVEFORM_MAX_ENTRIES; i++)
+	{
+		if (entries[i].length == 0)
+			return &entries[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Use `size` bytes at `storage`, split into blocks of `period_size` bytes,
+ * the size of half of the play buffer. `copy` moves them, `memcpy()` if
+ * NULL.
+ */
+void waveform_init(void *storage_address, size_t size, size_t period_size, waveform_copy_t copy_function)
+{
+	size_t count = size / period_size;
+
+	storage = storage_address;
+	block_size = period_size;
+	block_count = count < WAVEFORM_MAX_BLOCKS ? count : WAVEFORM_MAX_BLOCKS;
+	copy = copy_function;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.size_bytes = block_count * block_size;
+
+	waveform_invalidate();
+}
+
+/*
+ * Forget every payload, and stop the one being played or recorded. To be
+ * called whenever the audio synthesised by the SDK changes.
+ */
+void waveform_invalidate(void)
+{
+	for (uint16_t i = 0; i < block_count; i++)
+		links[i] = i + 1 < block_count ? i + 1 : NO_BLOCK;
+
+	free_first = block_count > 0 ? 0 : NO_BLOCK;
+	free_count = block_count;
+
+	memset(entries, 0, sizeof(entries));
+	stats.entries = 0;
+
+	recording = NULL;
+	closing = false;
+	playing = NULL;
+}
+
+/*
+ * Start playing the audio of `payload` if it is cached. Returns false on a
+ * miss, the payload must then be sent by the SDK.
+ */
+bool waveform_play(const uint8_t *payload, size_t length)
+{
+	entry_t *entry = find(payload, length);
+
+	if (entry == NULL || !entry->complete)
+	{
+		stats.misses++;
+		return false;
+	}
+
+	entry->used = ++uses;
+	playing = entry;
+	play_block = entry->first;
+	play_remaining = entry->count;
+
+	stats.hits++;
+	return true;
+}
+
+/*
+ * Whether the audio of a payload is still being played from the cache.
+ */
+bool waveform_playing(void)
+{
+	return playing != NULL;
+}
+
+/*
+ * Drop the rest of the payload being played, and the one being recorded,
+ * for instance when the pipeline stops playing.
+ */
+void waveform_stop(void)
+{
+	playing = NULL;
+
+	if (recording)
+		release(recording);
+	closing = false;
+}
+
+/*
+ * Record the periods played from now on as the audio of `payload`, which
+ * the SDK has just started sending, until `waveform_record_end()`.
+ */
+void waveform_record(const uint8_t *payload, size_t length)
+{
+	if (block_count == 0 || length == 0 || length > WAVEFORM_MAX_PAYLOAD)
+		return;
+
+	if (recording)
+		release(recording);
+
+	entry_t *entry = find(payload, length);
+	if (entry)
+		release(entry);
+
+	entry = unused_entry();
+	if (entry == NULL)
+	{
+		if (!evict())
+			return;
+		entry = unused_entry();
+	}
+
+	memcpy(entry->payload, payload, length);
+	entry->length = length;
+	entry->complete = false;
+	entry->count = 0;
+	entry->first = NO_BLOCK;
+	entry->last = NO_BLOCK;
+
+	recording = entry;
+	closing = false;
+}
+
+/*
+ * Called once the SDK is done sending, from its `on_sent` callback. The
+ * period being synthesised is the last one recorded.
+ */
+void waveform_record_end(void)
+{
+	if (recording)
+		closing = true;
+}
+
+/*
+ * Called by the pipeline instead of the application when a period is to
+ * be played. Copies the next period of the payload being played into
+ * `period` and returns true, or returns false once it is over.
+ */
+bool waveform_fill(uint16_t *period)
+{
+	if (playing == NULL)
+		return false;
+
+	if (play_remaining == 0)
+	{
+		playing = NULL;
+		return false;
+	}
+
+	copy_block(period, block_address(play_block));
+	play_block = links[play_block];
+	play_remaining--;
+
+	return true;
+}
+
+/*
+ * Called by the pipeline with every period synthesised by the SDK, once
+ * written to the play buffer.
+ */
+void waveform_played(const uint16_t *period)
+{
+	if (recording == NULL)
+		return;
+
+	uint16_t block = allocate_block();
+	if (block == NO_BLOCK)
+	{
+		// Longer than the whole storage.
+		release(recording);
+		return;
+	}
+
+	copy_block(block_address(block), period);
+
+	if (recording->count == 0)
+		recording->first = block;
+	else
+		links[recording->last] = block;
+	recording->last = block;
+	recording->count++;
+
+	if (closing)
+	{
+		recording->complete = true;
+		recording->used = ++uses;
+		recording = NULL;
+		closing = false;
+		stats.entries++;
+	}
+}
+
+void waveform_get_stats(waveform_stats_t *out)
+{
+	*out = stats;
+	out->used_bytes = (block_count - free_count) * block_size;
+}
@@ -0,0 +1,24 @@
+/*------------------------------------------------------------------------------
+ *
+ *  credentials.h
+ *
+ *  For full information on usage and licensing, see https://chirp.io/
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+// The mock SDK accepts anything, only the Linux SDK needs real credentials.
+#ifndef CHIRP_SDK_MOCK
+#error("Add your credentials below (from https://developers.chirp.io) and delete this line.")
+#endif
+
+#define CHIRP_APP_KEY    "YOUR_APP_KEY"
+#define CHIRP_APP_SECRET "YOUR_APP_SECRET"
+#define CHIRP_APP_CONFIG "YOUR_APP_CONFIG"
+
+#endif /* !CREDENTIALS_H */
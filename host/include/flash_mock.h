@@ -0,0 +1,12 @@
+#ifndef FLASH_MOCK_H
+#define FLASH_MOCK_H
+
+#include "logstore.h"
+
+const logstore_flash_t *flash_mock_open(const char *path);
+
+void flash_mock_close(void);
+
+uint32_t flash_mock_erase_count(uint32_t address);
+
+#endif
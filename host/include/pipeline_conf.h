@@ -0,0 +1,13 @@
+#ifndef PIPELINE_CONF_H
+#define PIPELINE_CONF_H
+
+/*
+ * Same periods as the STM32F746G example: 512 frames of interleaved stereo,
+ * the beam of both channels being decoded.
+ */
+#define PIPELINE_PERIOD_LENGTH	512
+#define PIPELINE_BEAMFORMING	1
+#define PIPELINE_PREPROCESS		1
+#define PIPELINE_GATE			1
+
+#endif
@@ -0,0 +1,751 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file chirp_sdk_mock.c
+ *
+ *  @brief Stand-in for the Chirp C SDK on the host, implementing the same API
+ *  so that the examples code can be run and profiled without a board nor a
+ *  Linux build of the SDK. It is not the Chirp protocol: payloads are sent as
+ *  a simple multi-tone signal, one 40ms tone per nibble, which the receiving
+ *  side decodes with the Goertzel algorithm. It still goes through the same
+ *  states and callbacks, and its audio can be mixed with noise, delayed or
+ *  resampled to exercise the processing in front of the SDK.
+ *
+ *  A transmission is made of two marker symbols, the payload length, the
+ *  payload and a checksum, each byte being sent as two symbols, high nibble
+ *  first.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chirp_sdk.h"
+
+#define MOCK_VERSION			"0.1.0"
+#define MOCK_BUILD_NUMBER		"mock"
+
+#define MOCK_MAX_PAYLOAD_LENGTH	32
+#define MOCK_SYMBOL_SECONDS		0.04f
+#define MOCK_MARKER_SYMBOLS		2
+
+// Marker and nibbles tones, far enough apart for the Goertzel window.
+#define MOCK_MARKER_FREQUENCY	4000.0f
+#define MOCK_BASE_FREQUENCY		1200.0f
+#define MOCK_FREQUENCY_STEP		150.0f
+#define MOCK_TONES				16
+
+// Share of the block energy a tone needs to be considered present.
+#define MOCK_TONE_RATIO			0.3f
+// Mean power under which a block is considered silent.
+#define MOCK_SILENCE			1e-6f
+// Consecutive marker blocks needed to start receiving.
+#define MOCK_MARKER_BLOCKS		4
+
+#define MOCK_PI					3.14159265358979f
+
+typedef struct {
+	float coefficient;
+	float s1;
+	float s2;
+} goertzel_t;
+
+struct _chirp_sdk_t {
+	bool configured;
+	chirp_sdk_state_t state;
+	chirp_sdk_callback_set_t callbacks;
+	void *callback_ptr;
+	uint32_t input_sample_rate;
+	uint32_t output_sample_rate;
+	float volume;
+	float frequency_correction;
+	bool listen_to_self;
+	int32_t heap_usage;
+
+	// Sending side, the whole transmission as a list of tones.
+	uint8_t send_payload[MOCK_MAX_PAYLOAD_LENGTH];
+	size_t send_length;
+	uint8_t send_symbols[MOCK_MARKER_SYMBOLS + 2 * (MOCK_MAX_PAYLOAD_LENGTH + 2)];
+	size_t send_symbol_count;
+	size_t send_position;
+	float phase;
+
+	// Receiving side, independent from the sending one as the SDK may
+	// listen to itself. The input is cut in blocks of a quarter of a symbol
+	// until the end of the markers is found, then each symbol is analysed
+	// over its two middle quarters.
+	bool receiving;
+	uint32_t block_length;
+	uint32_t block_position;
+	uint32_t marker_blocks;
+	float energy;
+	goertzel_t marker;
+	goertzel_t tones[MOCK_TONES];
+	uint8_t received[MOCK_MAX_PAYLOAD_LENGTH + 2];
+	size_t received_symbols;
+	size_t expected_symbols;
+	uint8_t nibble;
+};
+
+static const struct {
+	chirp_sdk_error_code_t code;
+	const char *message;
+} error_strings[] = {
+	{ CHIRP_SDK_OK, "No error." },
+	{ CHIRP_SDK_OUT_OF_MEMORY, "The SDK ran out of memory." },
+	{ CHIRP_SDK_NOT_INITIALISED, "The SDK hasn't been initialised, did you forget to set the config?" },
+	{ CHIRP_SDK_NOT_RUNNING, "The SDK is not running." },
+	{ CHIRP_SDK_ALREADY_RUNNING, "The SDK is already running." },
+	{ CHIRP_SDK_ALREADY_STOPPED, "The SDK has already stopped." },
+	{ CHIRP_SDK_ALREADY_SENDING, "The SDK is already sending." },
+	{ CHIRP_SDK_INVALID_SAMPLE_RATE, "The sample rate is invalid." },
+	{ CHIRP_SDK_NULL_BUFFER, "One of the parameters is a NULL buffer." },
+	{ CHIRP_SDK_NULL_POINTER, "One of the parameters is a NULL pointer." },
+	{ CHIRP_SDK_CHANNEL_NOT_SUPPORTED, "The channel is not supported." },
+	{ CHIRP_SDK_INVALID_FREQUENCY_CORRECTION, "Invalid frequency correction value." },
+	{ CHIRP_SDK_PAYLOAD_EMPTY_MESSAGE, "The payload is empty." },
+	{ CHIRP_SDK_PAYLOAD_TOO_LONG, "The payload is too long." },
+	{ CHIRP_SDK_INVALID_VOLUME, "Volume value is incorrect." },
+};
+
+static void goertzel_init(goertzel_t *goertzel, float frequency, uint32_t sample_rate)
+{
+	goertzel->coefficient = 2.0f * cosf(2.0f * MOCK_PI * frequency / sample_rate);
+	goertzel->s1 = 0;
+	goertzel->s2 = 0;
+}
+
+static inline void goertzel_push(goertzel_t *goertzel, float sample)
+{
+	float s0 = sample + goertzel->coefficient * goertzel->s1 - goertzel->s2;
+	goertzel->s2 = goertzel->s1;
+	goertzel->s1 = s0;
+}
+
+/*
+ * Power of the tone over the last `length` samples, relative to the energy
+ * of these samples: close to 1 for a pure tone, close to 0 without it.
+ */
+static float goertzel_ratio(goertzel_t *goertzel, uint32_t length, float energy)
+{
+	float power = goertzel->s1 * goertzel->s1 + goertzel->s2 * goertzel->s2
+			- goertzel->coefficient * goertzel->s1 * goertzel->s2;
+
+	goertzel->s1 = 0;
+	goertzel->s2 = 0;
+
+	return energy > 0 ? 2.0f * power / (length * energy) : 0;
+}
+
+static float tone_frequency(uint8_t symbol)
+{
+	return symbol < MOCK_TONES ? MOCK_BASE_FREQUENCY + symbol * MOCK_FREQUENCY_STEP : MOCK_MARKER_FREQUENCY;
+}
+
+static uint8_t checksum(const uint8_t *bytes, size_t length)
+{
+	uint8_t sum = 0xA5;
+
+	for (size_t i = 0; i < length; i++)
+		sum += bytes[i];
+
+	return sum;
+}
+
+static void set_state(chirp_sdk_t *sdk, chirp_sdk_state_t state)
+{
+	chirp_sdk_state_t old_state = sdk->state;
+
+	sdk->state = state;
+	if (sdk->callbacks.on_state_changed && old_state != state)
+		sdk->callbacks.on_state_changed(sdk->callback_ptr, old_state, state);
+}
+
+/*
+ * Start looking for the markers again, with the tones tuned to the input
+ * sample rate and the frequency correction.
+ */
+static void reset_receiver(chirp_sdk_t *sdk)
+{
+	uint32_t rate = sdk->input_sample_rate;
+	float correction = sdk->frequency_correction;
+
+	sdk->block_length = (uint32_t) (rate * MOCK_SYMBOL_SECONDS) / 4;
+	sdk->receiving = false;
+	sdk->block_position = 0;
+	sdk->marker_blocks = 0;
+	sdk->energy = 0;
+	sdk->received_symbols = 0;
+	sdk->expected_symbols = 0;
+
+	goertzel_init(&sdk->marker, MOCK_MARKER_FREQUENCY * correction, rate);
+	for (uint8_t i = 0; i < MOCK_TONES; i++)
+		goertzel_init(&sdk->tones[i], tone_frequency(i) * correction, rate);
+}
+
+static void receive_done(chirp_sdk_t *sdk, bool success)
+{
+	size_t length = sdk->received[0];
+
+	if (success)
+		success = checksum(&sdk->received[1], length) == sdk->received[length + 1];
+
+	if (sdk->callbacks.on_received)
+	{
+		if (success)
+			sdk->callbacks.on_received(sdk->callback_ptr, &sdk->received[1], length, 0);
+		else
+			sdk->callbacks.on_received(sdk->callback_ptr, NULL, 0, 0);
+	}
+
+	reset_receiver(sdk);
+	set_state(sdk, sdk->send_symbol_count > 0 ? CHIRP_SDK_STATE_SENDING : CHIRP_SDK_STATE_RUNNING);
+}
+
+/*
+ * Look for the end of the markers, one block at a time.
+ */
+static void search_sample(chirp_sdk_t *sdk, float sample)
+{
+	goertzel_push(&sdk->marker, sample);
+	sdk->energy += sample * sample;
+
+	if (++sdk->block_position < sdk->block_length)
+		return;
+
+	float ratio = goertzel_ratio(&sdk->marker, sdk->block_length, sdk->energy);
+	bool loud = sdk->energy / sdk->block_length > MOCK_SILENCE;
+	bool marker = loud && ratio > MOCK_TONE_RATIO;
+
+	sdk->block_position = 0;
+	sdk->energy = 0;
+
+	if (marker)
+	{
+		sdk->marker_blocks++;
+	}
+	else if (loud && sdk->marker_blocks >= MOCK_MARKER_BLOCKS)
+	{
+		// This block is the start of the first symbol, give or take a
+		// block, the next two are analysed.
+		sdk->block_position = sdk->block_length;
+		sdk->received_symbols = 0;
+		sdk->expected_symbols = 2;
+		sdk->receiving = true;
+		set_state(sdk, CHIRP_SDK_STATE_RECEIVING);
+		if (sdk->callbacks.on_receiving)
+			sdk->callbacks.on_receiving(sdk->callback_ptr, NULL, 0, 0);
+	}
+	else
+	{
+		sdk->marker_blocks = 0;
+	}
+}
+
+/*
+ * Accumulate the current symbol and decode it once its middle is over.
+ */
+static void receive_sample(chirp_sdk_t *sdk, float sample)
+{
+	uint32_t window_start = sdk->block_length;
+	uint32_t window_end = 3 * sdk->block_length;
+
+	if (sdk->block_position >= window_start && sdk->block_position < window_end)
+	{
+		for (uint8_t i = 0; i < MOCK_TONES; i++)
+			goertzel_push(&sdk->tones[i], sample);
+		sdk->energy += sample * sample;
+	}
+
+	sdk->block_position++;
+
+	if (sdk->block_position == window_end)
+	{
+		uint32_t length = window_end - window_start;
+		float best_ratio = 0;
+		uint8_t best = 0;
+
+		for (uint8_t i = 0; i < MOCK_TONES; i++)
+		{
+			float ratio = goertzel_ratio(&sdk->tones[i], length, sdk->energy);
+			if (ratio > best_ratio)
+			{
+				best_ratio = ratio;
+				best = i;
+			}
+		}
+		sdk->energy = 0;
+
+		if (best_ratio < MOCK_TONE_RATIO)
+		{
+			receive_done(sdk, false);
+			return;
+		}
+
+		size_t index = sdk->received_symbols / 2;
+		if (sdk->received_symbols % 2 == 0)
+			sdk->nibble = best << 4;
+		else
+			sdk->received[index] = sdk->nibble | best;
+		sdk->received_symbols++;
+
+		// The first byte tells how many follow.
+		if (sdk->received_symbols == 2)
+		{
+			size_t length = sdk->received[0];
+			if (length == 0 || length > MOCK_MAX_PAYLOAD_LENGTH)
+			{
+				receive_done(sdk, false);
+				return;
+			}
+			sdk->expected_symbols = 2 * (length + 2);
+		}
+
+		if (sdk->received_symbols == sdk->expected_symbols)
+			receive_done(sdk, true);
+	}
+	else if (sdk->block_position == 4 * sdk->block_length)
+	{
+		sdk->block_position = 0;
+	}
+}
+
+static chirp_sdk_error_code_t check_running(chirp_sdk_t *sdk)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (!sdk->configured)
+		return CHIRP_SDK_NOT_INITIALISED;
+	if (sdk->state < CHIRP_SDK_STATE_RUNNING)
+		return CHIRP_SDK_NOT_RUNNING;
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_t *new_chirp_sdk(const char *key, const char *secret)
+{
+	chirp_sdk_t *sdk = calloc(1, sizeof(chirp_sdk_t));
+	if (sdk == NULL)
+		return NULL;
+
+	sdk->state = CHIRP_SDK_STATE_NOT_CREATED;
+	sdk->input_sample_rate = 44100;
+	sdk->output_sample_rate = 44100;
+	sdk->volume = 1.0f;
+	sdk->frequency_correction = 1.0f;
+	sdk->heap_usage = sizeof(chirp_sdk_t);
+
+	return sdk;
+}
+
+chirp_sdk_error_code_t del_chirp_sdk(chirp_sdk_t **sdk)
+{
+	if (sdk == NULL || *sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+
+	free(*sdk);
+	*sdk = NULL;
+
+	return CHIRP_SDK_OK;
+}
+
+void chirp_sdk_free(void *ptr)
+{
+	free(ptr);
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_config(chirp_sdk_t *sdk, const char *config)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+
+	sdk->configured = true;
+	sdk->state = CHIRP_SDK_STATE_STOPPED;
+	reset_receiver(sdk);
+
+	return CHIRP_SDK_OK;
+}
+
+char *chirp_sdk_get_info(chirp_sdk_t *sdk)
+{
+	const char *info = "Mock SDK [max 32 bytes], supporting 1 channel(s)";
+	char *copy = malloc(strlen(info) + 1);
+
+	if (copy != NULL)
+		strcpy(copy, info);
+
+	return copy;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_callbacks(chirp_sdk_t *sdk, chirp_sdk_callback_set_t callback_set)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+
+	sdk->callbacks = callback_set;
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_start(chirp_sdk_t *sdk)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (!sdk->configured)
+		return CHIRP_SDK_NOT_INITIALISED;
+	if (sdk->state >= CHIRP_SDK_STATE_RUNNING)
+		return CHIRP_SDK_ALREADY_RUNNING;
+
+	reset_receiver(sdk);
+	set_state(sdk, CHIRP_SDK_STATE_RUNNING);
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_stop(chirp_sdk_t *sdk)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (sdk->state < CHIRP_SDK_STATE_RUNNING)
+		return CHIRP_SDK_ALREADY_STOPPED;
+
+	set_state(sdk, CHIRP_SDK_STATE_STOPPED);
+
+	return CHIRP_SDK_OK;
+}
+
+size_t chirp_sdk_get_max_payload_length(chirp_sdk_t *sdk)
+{
+	return MOCK_MAX_PAYLOAD_LENGTH;
+}
+
+float chirp_sdk_get_duration_for_payload_length(chirp_sdk_t *sdk, size_t payload_length)
+{
+	return (MOCK_MARKER_SYMBOLS + 2 * (payload_length + 2)) * MOCK_SYMBOL_SECONDS;
+}
+
+chirp_sdk_error_code_t chirp_sdk_is_valid(chirp_sdk_t *sdk, const uint8_t *bytes, size_t length)
+{
+	if (bytes == NULL)
+		return CHIRP_SDK_NULL_BUFFER;
+	if (length == 0)
+		return CHIRP_SDK_PAYLOAD_EMPTY_MESSAGE;
+	if (length > MOCK_MAX_PAYLOAD_LENGTH)
+		return CHIRP_SDK_PAYLOAD_TOO_LONG;
+	return CHIRP_SDK_OK;
+}
+
+uint8_t *chirp_sdk_random_payload(chirp_sdk_t *sdk, size_t *length)
+{
+	if (*length == 0 || *length > MOCK_MAX_PAYLOAD_LENGTH)
+		*length = 1 + rand() % MOCK_MAX_PAYLOAD_LENGTH;
+
+	uint8_t *payload = malloc(*length);
+	if (payload == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < *length; i++)
+		payload[i] = rand();
+
+	return payload;
+}
+
+chirp_sdk_error_code_t chirp_sdk_send(chirp_sdk_t *sdk, uint8_t *bytes, size_t length)
+{
+	chirp_sdk_error_code_t error = check_running(sdk);
+	if (error != CHIRP_SDK_OK)
+		return error;
+	if (sdk->send_symbol_count > 0)
+		return CHIRP_SDK_ALREADY_SENDING;
+
+	error = chirp_sdk_is_valid(sdk, bytes, length);
+	if (error != CHIRP_SDK_OK)
+		return error;
+
+	memcpy(sdk->send_payload, bytes, length);
+	sdk->send_length = length;
+
+	size_t count = 0;
+	for (size_t i = 0; i < MOCK_MARKER_SYMBOLS; i++)
+		sdk->send_symbols[count++] = MOCK_TONES;
+
+	uint8_t sum = checksum(bytes, length);
+	for (size_t i = 0; i < length + 2; i++)
+	{
+		uint8_t byte = i == 0 ? length : i <= length ? bytes[i - 1] : sum;
+		sdk->send_symbols[count++] = byte >> 4;
+		sdk->send_symbols[count++] = byte & 0x0F;
+	}
+	sdk->send_symbol_count = count;
+	sdk->send_position = 0;
+	sdk->phase = 0;
+
+	set_state(sdk, CHIRP_SDK_STATE_SENDING);
+	if (sdk->callbacks.on_sending)
+		sdk->callbacks.on_sending(sdk->callback_ptr, sdk->send_payload, length, 0);
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_process(chirp_sdk_t *sdk, float *in, float *out, size_t length)
+{
+	chirp_sdk_error_code_t error = chirp_sdk_process_input(sdk, in, length);
+	if (error != CHIRP_SDK_OK)
+		return error;
+
+	return chirp_sdk_process_output(sdk, out, length);
+}
+
+chirp_sdk_error_code_t chirp_sdk_process_input(chirp_sdk_t *sdk, float *buffer, size_t length)
+{
+	chirp_sdk_error_code_t error = check_running(sdk);
+	if (error != CHIRP_SDK_OK)
+		return error;
+	if (buffer == NULL)
+		return CHIRP_SDK_NULL_BUFFER;
+
+	// Like the SDK, do not decode our own transmission unless asked to.
+	if (sdk->send_symbol_count > 0 && !sdk->listen_to_self)
+		return CHIRP_SDK_OK;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (sdk->receiving)
+			receive_sample(sdk, buffer[i]);
+		else
+			search_sample(sdk, buffer[i]);
+	}
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_process_output(chirp_sdk_t *sdk, float *buffer, size_t length)
+{
+	chirp_sdk_error_code_t error = check_running(sdk);
+	if (error != CHIRP_SDK_OK)
+		return error;
+	if (buffer == NULL)
+		return CHIRP_SDK_NULL_BUFFER;
+
+	if (sdk->send_symbol_count == 0)
+	{
+		memset(buffer, 0, length * sizeof(float));
+		return CHIRP_SDK_OK;
+	}
+
+	uint32_t rate = sdk->output_sample_rate;
+	size_t symbol_length = (size_t) (rate * MOCK_SYMBOL_SECONDS) / 4 * 4;
+	size_t total = sdk->send_symbol_count * symbol_length;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (sdk->send_position >= total)
+		{
+			buffer[i] = 0;
+			continue;
+		}
+
+		float frequency = tone_frequency(sdk->send_symbols[sdk->send_position / symbol_length]);
+		buffer[i] = sdk->volume * sinf(sdk->phase);
+
+		sdk->phase += 2.0f * MOCK_PI * frequency / rate;
+		if (sdk->phase > 2.0f * MOCK_PI)
+			sdk->phase -= 2.0f * MOCK_PI;
+		sdk->send_position++;
+	}
+
+	if (sdk->send_position >= total)
+	{
+		sdk->send_symbol_count = 0;
+		if (sdk->callbacks.on_sent)
+			sdk->callbacks.on_sent(sdk->callback_ptr, sdk->send_payload, sdk->send_length, 0);
+		set_state(sdk, sdk->receiving ? CHIRP_SDK_STATE_RECEIVING : CHIRP_SDK_STATE_RUNNING);
+	}
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_process_shorts(chirp_sdk_t *sdk, short *in, short *out, size_t length)
+{
+	chirp_sdk_error_code_t error = chirp_sdk_process_shorts_input(sdk, in, length);
+	if (error != CHIRP_SDK_OK)
+		return error;
+
+	return chirp_sdk_process_shorts_output(sdk, out, length);
+}
+
+chirp_sdk_error_code_t chirp_sdk_process_shorts_input(chirp_sdk_t *sdk, const short *buffer, size_t length)
+{
+	if (buffer == NULL)
+		return CHIRP_SDK_NULL_BUFFER;
+
+	float samples[length];
+	for (size_t i = 0; i < length; i++)
+		samples[i] = buffer[i] / 32768.0f;
+
+	return chirp_sdk_process_input(sdk, samples, length);
+}
+
+chirp_sdk_error_code_t chirp_sdk_process_shorts_output(chirp_sdk_t *sdk, short *buffer, size_t length)
+{
+	if (buffer == NULL)
+		return CHIRP_SDK_NULL_BUFFER;
+
+	float samples[length];
+	chirp_sdk_error_code_t error = chirp_sdk_process_output(sdk, samples, length);
+	if (error != CHIRP_SDK_OK)
+		return error;
+
+	for (size_t i = 0; i < length; i++)
+		buffer[i] = samples[i] * 32767.0f;
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_state_t chirp_sdk_get_state_for_channel(chirp_sdk_t *sdk, uint8_t channel)
+{
+	return channel == 0 ? chirp_sdk_get_state(sdk) : CHIRP_SDK_STATE_NOT_CREATED;
+}
+
+int8_t chirp_sdk_get_transmission_channel(chirp_sdk_t *sdk)
+{
+	return 0;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_transmission_channel(chirp_sdk_t *sdk, uint8_t channel)
+{
+	return channel == 0 ? CHIRP_SDK_OK : CHIRP_SDK_CHANNEL_NOT_SUPPORTED;
+}
+
+uint8_t chirp_sdk_get_channel_count(chirp_sdk_t *sdk)
+{
+	return 1;
+}
+
+chirp_sdk_state_t chirp_sdk_get_state(chirp_sdk_t *sdk)
+{
+	return sdk ? sdk->state : CHIRP_SDK_STATE_NOT_CREATED;
+}
+
+float chirp_sdk_get_volume(chirp_sdk_t *sdk)
+{
+	return sdk->volume;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_volume(chirp_sdk_t *sdk, float volume)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (volume < 0 || volume > 1)
+		return CHIRP_SDK_INVALID_VOLUME;
+
+	sdk->volume = volume;
+
+	return CHIRP_SDK_OK;
+}
+
+uint32_t chirp_sdk_get_input_sample_rate(chirp_sdk_t *sdk)
+{
+	return sdk->input_sample_rate;
+}
+
+uint32_t chirp_sdk_get_output_sample_rate(chirp_sdk_t *sdk)
+{
+	return sdk->output_sample_rate;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_input_sample_rate(chirp_sdk_t *sdk, uint32_t sample_rate)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (sample_rate < 2 * MOCK_MARKER_FREQUENCY + 1000)
+		return CHIRP_SDK_INVALID_SAMPLE_RATE;
+
+	sdk->input_sample_rate = sample_rate;
+	reset_receiver(sdk);
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_output_sample_rate(chirp_sdk_t *sdk, uint32_t sample_rate)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (sample_rate < 2 * MOCK_MARKER_FREQUENCY + 1000)
+		return CHIRP_SDK_INVALID_SAMPLE_RATE;
+
+	sdk->output_sample_rate = sample_rate;
+
+	return CHIRP_SDK_OK;
+}
+
+bool chirp_sdk_get_listen_to_self(chirp_sdk_t *sdk)
+{
+	return sdk->listen_to_self;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_listen_to_self(chirp_sdk_t *sdk, bool listen_to_self)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+
+	sdk->listen_to_self = listen_to_self;
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_callback_ptr(chirp_sdk_t *sdk, void *ptr)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+
+	sdk->callback_ptr = ptr;
+
+	return CHIRP_SDK_OK;
+}
+
+chirp_sdk_error_code_t chirp_sdk_set_frequency_correction(chirp_sdk_t *sdk, float correction)
+{
+	if (sdk == NULL)
+		return CHIRP_SDK_NULL_POINTER;
+	if (correction < 0.5f || correction > 1.5f)
+		return CHIRP_SDK_INVALID_FREQUENCY_CORRECTION;
+
+	sdk->frequency_correction = correction;
+	reset_receiver(sdk);
+
+	return CHIRP_SDK_OK;
+}
+
+int32_t chirp_sdk_get_heap_usage(chirp_sdk_t *sdk)
+{
+	return sdk->heap_usage;
+}
+
+const char *chirp_sdk_error_code_to_string(chirp_sdk_error_code_t err)
+{
+	for (size_t i = 0; i < sizeof(error_strings) / sizeof(error_strings[0]); i++)
+	{
+		if (error_strings[i].code == err)
+			return error_strings[i].message;
+	}
+
+	return "The SDK has reported an unknown error.";
+}
+
+const char *chirp_sdk_get_library_name(void)
+{
+	return "Chirp SDK mock";
+}
+
+const char *chirp_sdk_get_version(void)
+{
+	return MOCK_VERSION;
+}
+
+const char *chirp_sdk_get_build_number(void)
+{
+	return MOCK_BUILD_NUMBER;
+}
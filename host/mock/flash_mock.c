@@ -0,0 +1,148 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file flash_mock.c
+ *
+ *  @brief NOR flash kept in a file, standing in for the QSPI flash of the
+ *  boards under the log store. It behaves as the flash does: programming
+ *  only clears bits and cannot cross a page, erasing sets a whole sector, and
+ *  both keep the flash busy for a while, counted in calls to `busy()`, so
+ *  that the store is run asynchronously as on the boards. The file is kept
+ *  between runs, as the flash is between resets.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "flash_mock.h"
+
+// Geometry of the subsectors of the N25Q128A, over 1MB.
+#define FLASH_SIZE			(1024 * 1024)
+#define FLASH_SECTOR_SIZE	4096
+#define FLASH_PAGE_SIZE		256
+
+// Calls to `busy()` an erase and a program last.
+#define FLASH_ERASE_BUSY	50
+#define FLASH_PROGRAM_BUSY	2
+
+static FILE *file = NULL;
+static unsigned busy_count = 0;
+
+// Erases of every sector since the file was opened.
+static uint32_t erase_counts[FLASH_SIZE / FLASH_SECTOR_SIZE];
+
+static bool mock_read(uint32_t address, void *data, size_t size)
+{
+	if (busy_count > 0 || address + size > FLASH_SIZE)
+		return false;
+
+	return fseek(file, address, SEEK_SET) == 0 && fread(data, 1, size, file) == size;
+}
+
+static bool mock_program(uint32_t address, const void *data, size_t size)
+{
+	uint8_t page[FLASH_PAGE_SIZE];
+	const uint8_t *bytes = data;
+
+	if (busy_count > 0 || size == 0 || address % FLASH_PAGE_SIZE + size > FLASH_PAGE_SIZE)
+		return false;
+
+	if (fseek(file, address, SEEK_SET) != 0 || fread(page, 1, size, file) != size)
+		return false;
+
+	// Programming can only clear bits.
+	for (size_t i = 0; i < size; i++)
+		page[i] &= bytes[i];
+
+	busy_count = FLASH_PROGRAM_BUSY;
+
+	return fseek(file, address, SEEK_SET) == 0 && fwrite(page, 1, size, file) == size;
+}
+
+static bool mock_erase(uint32_t address)
+{
+	uint8_t sector[FLASH_SECTOR_SIZE];
+
+	if (busy_count > 0 || address % FLASH_SECTOR_SIZE != 0 || address >= FLASH_SIZE)
+		return false;
+
+	memset(sector, 0xFF, sizeof(sector));
+	busy_count = FLASH_ERASE_BUSY;
+	erase_counts[address / FLASH_SECTOR_SIZE]++;
+
+	return fseek(file, address, SEEK_SET) == 0 && fwrite(sector, 1, sizeof(sector), file) == sizeof(sector);
+}
+
+static bool mock_busy(void)
+{
+	if (busy_count == 0)
+		return false;
+
+	busy_count--;
+	return true;
+}
+
+static uint32_t mock_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint32_t) (time.tv_sec * 1000 + time.tv_nsec / 1000000);
+}
+
+static const logstore_flash_t flash = {
+	.address = 0,
+	.size = FLASH_SIZE,
+	.sector_size = FLASH_SECTOR_SIZE,
+	.page_size = FLASH_PAGE_SIZE,
+	.read = mock_read,
+	.program = mock_program,
+	.erase = mock_erase,
+	.busy = mock_busy,
+	.time = mock_time,
+};
+
+/*
+ * Open the flash kept in `path`, created erased if it does not exist.
+ */
+const logstore_flash_t *flash_mock_open(const char *path)
+{
+	file = fopen(path, "r+b");
+	if (file == NULL)
+	{
+		file = fopen(path, "w+b");
+		if (file == NULL)
+			return NULL;
+
+		uint8_t erased[FLASH_SECTOR_SIZE];
+		memset(erased, 0xFF, sizeof(erased));
+		for (uint32_t i = 0; i < FLASH_SIZE / FLASH_SECTOR_SIZE; i++)
+		{
+			if (fwrite(erased, 1, sizeof(erased), file) != sizeof(erased))
+				return NULL;
+		}
+	}
+
+	busy_count = 0;
+	memset(erase_counts, 0, sizeof(erase_counts));
+
+	return &flash;
+}
+
+/*
+ * Erases of the sector at `address` since the flash was opened.
+ */
+uint32_t flash_mock_erase_count(uint32_t address)
+{
+	return address < FLASH_SIZE ? erase_counts[address / FLASH_SECTOR_SIZE] : 0;
+}
+
+void flash_mock_close(void)
+{
+	if (file)
+		fclose(file);
+	file = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef MAIN_H
+#define MAIN_H
+
+#include <stdint.h>
+
+/*
+ * Stand-in for the main.h of the STM32F746G example, with only what
+ * dma_buffer.c needs to build on the host. The cache maintenance functions
+ * of the CMSIS are implemented by the test, which records their calls.
+ */
+#define SRAM2_BASE		0x2004C000u
+
+void SCB_CleanDCache_by_Addr(uint32_t *address, int32_t size);
+
+void SCB_InvalidateDCache_by_Addr(uint32_t *address, int32_t size);
+
+#endif
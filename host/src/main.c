@@ -0,0 +1,490 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  Host simulation of the Chirp examples.
+ *
+ *  @file main.c
+ *
+ *  @brief Runs the audio pipeline shared with the boards, one period at a
+ *  time, the way their main loop does. A first SDK instance plays the part of
+ *  the sender, its output is written to the record buffer as the codec would
+ *  and handed to the pipeline, which decodes it with a second SDK instance.
+ *  Random payloads are sent one after the other, each one is checked once
+ *  received, and the time spent processing every period is measured against
+ *  the real-time budget.
+ *
+ *  Usage: chirp-host [-p payloads] [-n noise] [-d delay] [-r rumble]
+ *                    [-l level] [-s silence] [-f file] [-b fraction]
+ *                    [-P] [-G] [-D] [-E]
+ *
+ *  -p  Number of payloads sent, 10 by default.
+ *  -n  Amplitude of the white noise added to each recorded channel.
+ *  -d  Frames by which the right channel hears the sender before the left
+ *      one, negative for after, as a pair of microphones would.
+ *  -r  Amplitude of the low frequency hum added to the recorded audio, the
+ *      rumble of a ventilation system.
+ *  -l  Gain applied to the sender before the recording clips, 1 by default.
+ *  -s  Seconds of silence recorded before each payload, 0 by default.
+ *  -P  Bypass the pre-processing of the pipeline, to compare decode rates.
+ *  -f  Keep the log of the boards in `file`, standing in for their QSPI
+ *      flash, see fieldlog.c. The file is kept between runs.
+ *  -b  Fail if the pipeline takes more than `fraction` of the real-time
+ *      budget on average, or a period takes longer than the budget.
+ *  -G  Keep the gate of the pipeline open, to compare the processing time.
+ *  -D  Print every record of the log once done, as CSV.
+ *  -E  Print the events of both SDKs, stamped with the time of the audio
+ *      recorded so far, and the histograms of their latencies once done,
+ *      see eventlog.c.
+ *
+ *  The program exits with 1 if a payload was not received intact, or if the
+ *  processing went over what `-b` allows.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chirp_sdk.h"
+#include "credentials.h"
+#include "eventlog.h"
+#include "fieldlog.h"
+#include "flash_mock.h"
+#include "pipeline.h"
+
+// Same sample rate and periods as the STM32F746G example, see
+// pipeline_conf.h.
+#define SAMPLE_RATE			44100
+#define SHORT_BUFFER_SIZE	PIPELINE_BUFFER_LENGTH
+#define FLOAT_BUFFER_SIZE	PIPELINE_FLOAT_LENGTH
+
+#define DEFAULT_PAYLOADS	10
+
+// Time given to a payload to come back on top of its duration, in seconds.
+#define RECEIVE_MARGIN		1.0f
+
+// Mains hum and its first harmonic.
+#define RUMBLE_FREQUENCY	50.0f
+
+// Recorded periods kept for the log, as the capture ring of the boards does.
+#define HISTORY_PERIODS		16
+
+#ifdef CHIRP_SDK_MOCK
+// Band of the tones of the mock SDK, see chirp_sdk_mock.c. It is no protocol
+// the pipeline knows, so it is set here rather than found from its info.
+#define MOCK_BAND_LOW		900.0f
+#define MOCK_BAND_HIGH		4500.0f
+#endif
+
+/*
+ * What happens to the audio of the sender on its way to the microphones.
+ */
+typedef struct {
+	float noise;
+	int delay;
+	float rumble;
+	float level;
+} room_t;
+
+static chirp_sdk_t *sender = NULL;
+static chirp_sdk_t *receiver = NULL;
+
+static uint16_t short_record_buffer[SHORT_BUFFER_SIZE];
+static uint16_t short_play_buffer[SHORT_BUFFER_SIZE];
+static float float_buffer[FLOAT_BUFFER_SIZE];
+static uint16_t history[HISTORY_PERIODS][SHORT_BUFFER_SIZE / 2];
+static uint32_t recorded = 0;
+
+// Position of the audio processed by the SDK, see eventlog.h.
+static uint32_t position = 0;
+
+static uint8_t sent_payload[64];
+static size_t sent_length = 0;
+
+static unsigned received = 0;
+static unsigned failed = 0;
+static bool done = false;
+
+// Time spent in the pipeline, and in the SDK decoding.
+static unsigned long periods = 0;
+static double total = 0;
+static double worst = 0;
+static unsigned long decoded = 0;
+static double decoding = 0;
+
+static void chirp_error_handler(chirp_sdk_error_code_t error)
+{
+	if (error != CHIRP_SDK_OK)
+	{
+		printf("Chirp error handler : %s\n", chirp_sdk_error_code_to_string(error));
+		exit(2);
+	}
+}
+
+static void on_state_changed_callback(void *data, chirp_sdk_state_t old_state, chirp_sdk_state_t new_state)
+{
+	eventlog_state(old_state, new_state);
+}
+
+static void on_sending_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
+{
+	eventlog_payload(EVENTLOG_SENDING, payload, length, channel);
+}
+
+static void on_sent_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
+{
+	eventlog_payload(EVENTLOG_SENT, payload, length, channel);
+}
+
+static void on_receiving_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
+{
+	eventlog_payload(EVENTLOG_RECEIVING, payload, length, channel);
+}
+
+static void on_received_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
+{
+	eventlog_payload(EVENTLOG_RECEIVED, payload, length, channel);
+	fieldlog_decode(payload, length);
+
+	if (payload && length == sent_length && memcmp(payload, sent_payload, length) == 0)
+	{
+		received++;
+	}
+	else
+	{
+		printf("Decoding failed.\n");
+		failed++;
+	}
+
+	done = true;
+}
+
+static chirp_sdk_t *create_sdk(chirp_sdk_callback_set_t callbacks)
+{
+	chirp_sdk_t *chirp = new_chirp_sdk(CHIRP_APP_KEY, CHIRP_APP_SECRET);
+	if (chirp == NULL)
+	{
+		printf("Chirp SDK initialisation failed.\n");
+		exit(2);
+	}
+
+	chirp_error_handler(chirp_sdk_set_config(chirp, CHIRP_APP_CONFIG));
+	chirp_error_handler(chirp_sdk_set_input_sample_rate(chirp, SAMPLE_RATE));
+	chirp_error_handler(chirp_sdk_set_output_sample_rate(chirp, SAMPLE_RATE));
+
+	chirp_error_handler(chirp_sdk_set_callbacks(chirp, callbacks));
+
+	chirp_error_handler(chirp_sdk_set_volume(chirp, 0.25f));
+	chirp_error_handler(chirp_sdk_start(chirp));
+
+	return chirp;
+}
+
+/*
+ * The host runs faster than real time, the events are stamped with the time
+ * of the audio recorded so far instead.
+ */
+static uint32_t audio_micros(void)
+{
+	return (uint64_t) recorded * FLOAT_BUFFER_SIZE * 1000000 / SAMPLE_RATE;
+}
+
+static uint32_t audio_position(void)
+{
+	return position;
+}
+
+static const eventlog_clock_t audio_clock = {
+	.micros = audio_micros,
+	.position = audio_position,
+};
+
+static double now(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*
+ * Application side of the pipeline, as in the boards application.c.
+ */
+static void loop(float *buffer, uint16_t length)
+{
+	double start = now();
+
+	position = pipeline_position();
+	chirp_error_handler(chirp_sdk_process_input(receiver, buffer, length));
+	chirp_error_handler(chirp_sdk_process_output(receiver, buffer, length));
+
+	decoding += now() - start;
+	decoded++;
+}
+
+static bool can_skip(void)
+{
+	return chirp_sdk_get_state(receiver) == CHIRP_SDK_STATE_RUNNING;
+}
+
+static uint32_t recorded_count(void)
+{
+	return recorded;
+}
+
+/*
+ * Stand-in for `capture_replay()` of the boards, over the last periods.
+ */
+static uint32_t replay(uint32_t first, uint32_t count, pipeline_period_t callback)
+{
+	uint32_t replayed = 0;
+
+	for (uint32_t index = first; replayed < count && index < recorded; index++, replayed++)
+	{
+		if (recorded - index > HISTORY_PERIODS)
+			break;
+		callback(history[index % HISTORY_PERIODS]);
+	}
+
+	return replayed;
+}
+
+static uint16_t to_sample(float sample, float noise)
+{
+	sample += noise * (2.0f * rand() / RAND_MAX - 1.0f);
+	if (sample > 1.0f)
+		sample = 1.0f;
+	if (sample < -1.0f)
+		sample = -1.0f;
+
+	return (uint16_t) (int16_t) (sample * 32767.0f);
+}
+
+/*
+ * Stand-in for the codec and the record DMA: fill the `half` of the record
+ * buffer with the next period of the sender, as heard in `room`. The right
+ * channel is `delay` frames ahead of the left one, each one gets its own
+ * noise and both the same rumble.
+ */
+static void record_period(uint8_t half, const room_t *room)
+{
+	// The previous period followed by the current one.
+	static float samples[2 * FLOAT_BUFFER_SIZE];
+	static unsigned long frames = 0;
+	uint16_t *period = &short_record_buffer[half * SHORT_BUFFER_SIZE / 2];
+	const float *current = &samples[FLOAT_BUFFER_SIZE];
+	int left = room->delay > 0 ? room->delay : 0;
+	int right = room->delay < 0 ? -room->delay : 0;
+
+	memcpy(samples, current, FLOAT_BUFFER_SIZE * sizeof(float));
+	position = recorded * FLOAT_BUFFER_SIZE;
+	chirp_error_handler(chirp_sdk_process_output(sender, &samples[FLOAT_BUFFER_SIZE], FLOAT_BUFFER_SIZE));
+
+	for (int i = 0; i < FLOAT_BUFFER_SIZE; i++, frames++)
+	{
+		float phase = 2.0f * (float) M_PI * RUMBLE_FREQUENCY * frames / SAMPLE_RATE;
+		float rumble = room->rumble * (0.7f * sinf(phase) + 0.3f * sinf(2.0f * phase));
+
+		period[i * 2] = to_sample(current[i - left] * room->level + rumble, room->noise);
+		period[i * 2 + 1] = to_sample(current[i - right] * room->level + rumble, room->noise);
+	}
+
+	memcpy(history[recorded % HISTORY_PERIODS], period, sizeof(history[0]));
+	recorded++;
+
+	pipeline_recorded(half);
+}
+
+/*
+ * Record the next period and time the pipeline processing it.
+ */
+static void run_period(const room_t *room)
+{
+	record_period(periods % 2, room);
+
+	double start = now();
+	pipeline_process();
+	double elapsed = now() - start;
+
+	fieldlog_process();
+	eventlog_process();
+
+	total += elapsed;
+	if (elapsed > worst)
+		worst = elapsed;
+	periods++;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned payloads = DEFAULT_PAYLOADS;
+	room_t room = { .level = 1.0f };
+	float silence = 0;
+	bool preprocess = true;
+	bool gate = true;
+	const char *log_path = NULL;
+	bool dump = false;
+	bool events = false;
+	float fraction = 0;
+	int option;
+
+	while ((option = getopt(argc, argv, "p:n:d:r:l:s:f:b:PGDE")) != -1)
+	{
+		switch (option)
+		{
+		case 'p': payloads = (unsigned) atoi(optarg); break;
+		case 'n': room.noise = (float) atof(optarg); break;
+		case 'd': room.delay = atoi(optarg); break;
+		case 'r': room.rumble = (float) atof(optarg); break;
+		case 'l': room.level = (float) atof(optarg); break;
+		case 's': silence = (float) atof(optarg); break;
+		case 'f': log_path = optarg; break;
+		case 'b': fraction = (float) atof(optarg); break;
+		case 'P': preprocess = false; break;
+		case 'G': gate = false; break;
+		case 'D': dump = true; break;
+		case 'E': events = true; break;
+		default:
+			printf("Usage: %s [-p payloads] [-n noise] [-d delay] [-r rumble] [-l level] [-s silence] [-f file] "
+					"[-b fraction] [-P] [-G] [-D] [-E]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (room.delay <= -FLOAT_BUFFER_SIZE || room.delay >= FLOAT_BUFFER_SIZE)
+	{
+		printf("The delay must be shorter than a period.\n");
+		return 2;
+	}
+
+	if (log_path)
+	{
+		const fieldlog_config_t log_config = {
+			.flash = flash_mock_open(log_path),
+			.sample_rate = SAMPLE_RATE,
+			.recorded_count = recorded_count,
+			.replay = replay,
+		};
+
+		if (log_config.flash == NULL || !fieldlog_init(&log_config))
+		{
+			printf("Opening the log in %s failed.\n", log_path);
+			return 2;
+		}
+	}
+
+	srand(1);
+
+	chirp_sdk_callback_set_t callbacks = {0};
+	callbacks.on_state_changed = on_state_changed_callback;
+	callbacks.on_sending = on_sending_callback;
+	callbacks.on_sent = on_sent_callback;
+	sender = create_sdk(callbacks);
+
+	callbacks = (chirp_sdk_callback_set_t) {0};
+	callbacks.on_state_changed = on_state_changed_callback;
+	callbacks.on_receiving = on_receiving_callback;
+	callbacks.on_received = on_received_callback;
+	receiver = create_sdk(callbacks);
+
+	if (events)
+		eventlog_init(receiver, &audio_clock, SAMPLE_RATE);
+
+	char *info = chirp_sdk_get_info(receiver);
+	printf("%s - Version : %s\n", info, chirp_sdk_get_version());
+
+#ifdef CHIRP_SDK_MOCK
+	bool band = pipeline_set_band(MOCK_BAND_LOW, MOCK_BAND_HIGH, SAMPLE_RATE);
+#else
+	bool band = pipeline_set_band_from_info(info, SAMPLE_RATE);
+#endif
+	if (!band)
+		printf("No band known for \"%s\", the input is only levelled.\n", info);
+	pipeline_set_preprocess(preprocess);
+	chirp_sdk_free(info);
+
+	static const pipeline_hal_t hal = {0};
+	const pipeline_config_t config = {
+		.record_buffer = short_record_buffer,
+		.play_buffer = short_play_buffer,
+		.float_buffer = float_buffer,
+		.loop = loop,
+		.can_skip = can_skip,
+		.hal = &hal,
+	};
+	pipeline_init(&config);
+	pipeline_set_gate(gate);
+	pipeline_set_mode(PIPELINE_LISTENING);
+
+	unsigned long quiet = silence * SAMPLE_RATE / FLOAT_BUFFER_SIZE;
+
+	for (unsigned i = 0; i < payloads; i++)
+	{
+		for (unsigned long period = 0; period < quiet; period++)
+			run_period(&room);
+
+		sent_length = 0;
+		uint8_t *payload = chirp_sdk_random_payload(sender, &sent_length);
+		memcpy(sent_payload, payload, sent_length);
+		position = recorded * FLOAT_BUFFER_SIZE;
+		chirp_error_handler(chirp_sdk_send(sender, payload, sent_length));
+		chirp_sdk_free(payload);
+
+		float seconds = chirp_sdk_get_duration_for_payload_length(sender, sent_length) + RECEIVE_MARGIN;
+		unsigned long timeout = seconds * SAMPLE_RATE / FLOAT_BUFFER_SIZE;
+
+		// The payload can be decoded before the end of its last symbol has
+		// been played, wait for both.
+		done = false;
+		for (unsigned long period = 0; period < timeout; period++)
+		{
+			if (done && chirp_sdk_get_state(sender) == CHIRP_SDK_STATE_RUNNING)
+				break;
+
+			run_period(&room);
+		}
+
+		if (!done)
+		{
+			printf("Payload %u never received.\n", i);
+			failed++;
+		}
+	}
+
+	double budget = (double) FLOAT_BUFFER_SIZE / SAMPLE_RATE;
+	printf("Payloads: %u sent, %u received, %u failed.\n", payloads, received, failed);
+	printf("Processing: %lu periods, %.1f us average, %.1f us worst, %.1f us budget.\n",
+			periods, periods ? total / periods * 1e6 : 0, worst * 1e6, budget * 1e6);
+	printf("Heap: %d bytes used by the SDK.\n", chirp_sdk_get_heap_usage(receiver));
+
+	bool over_budget = false;
+	if (fraction > 0 && periods && (total / periods > fraction * budget || worst > budget))
+	{
+		printf("Processing over budget: %.1f us average allowed.\n", fraction * budget * 1e6);
+		over_budget = true;
+	}
+	printf("Beam: %d frames of delay tracked, %d simulated.\n", pipeline_beam_delay(), room.delay);
+	printf("Gain: %.2f applied to the last period.\n", pipeline_gain());
+	printf("Gate: %lu of %lu periods skipped, %lu given to the SDK in %.1f us average.\n",
+			(unsigned long) pipeline_skipped_periods(), periods, decoded, decoded ? decoding / decoded * 1e6 : 0);
+
+	eventlog_report();
+
+	if (log_path)
+	{
+		if (dump)
+			fieldlog_dump();
+		logstore_flush();
+		fieldlog_print();
+		flash_mock_close();
+	}
+
+	del_chirp_sdk(&sender);
+	del_chirp_sdk(&receiver);
+
+	return received == payloads && !over_budget ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file arena_test.c
+ *
+ *  @brief Fragmentation stress test of the arena. Blocks of the sizes the
+ *  SDK allocates, from a few bytes to buffers of several periods, are
+ *  allocated, resized and freed in a random order for many rounds. Every
+ *  block is filled with its own pattern and checked intact when freed, and
+ *  the arena must end up as a single free block as large as at the start.
+ *
+ *  The arena replaces malloc() here as well, the standard output buffer is
+ *  allocated from it before the first statistics are taken.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "check.h"
+
+#define BLOCKS		64
+#define ROUNDS		20000
+
+typedef struct {
+	uint8_t *data;
+	size_t size;
+	uint8_t pattern;
+} block_t;
+
+static block_t blocks[BLOCKS];
+
+// xorshift32, the same sequence on every run.
+static uint32_t state = 2463534242u;
+
+static uint32_t next_random(void)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/*
+ * Mostly small blocks, some the size of a period of floats and a few of
+ * several periods, as the SDK allocates them.
+ */
+static size_t random_size(void)
+{
+	uint32_t kind = next_random() % 16;
+
+	if (kind < 10)
+		return 1 + next_random() % 96;
+	if (kind < 15)
+		return 512 + next_random() % 2048;
+	return 8192 + next_random() % 8192;
+}
+
+static void fill(block_t *block)
+{
+	for (size_t i = 0; i < block->size; i++)
+		block->data[i] = (uint8_t) (block->pattern + i);
+}
+
+static bool intact(const block_t *block, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		if (block->data[i] != (uint8_t) (block->pattern + i))
+			return false;
+	}
+
+	return true;
+}
+
+static void allocate(block_t *block, size_t size)
+{
+	block->data = arena_alloc(size);
+	if (block->data == NULL)
+		return;
+
+	CHECK((uintptr_t) block->data % 8 == 0);
+	block->size = size;
+	block->pattern = (uint8_t) next_random();
+	fill(block);
+}
+
+static void release(block_t *block)
+{
+	CHECK(intact(block, block->size));
+	arena_free(block->data);
+	block->data = NULL;
+}
+
+static void resize(block_t *block, size_t size)
+{
+	uint8_t *moved = arena_realloc(block->data, size);
+	if (moved == NULL)
+	{
+		// The block is left as it was.
+		CHECK(intact(block, block->size));
+		return;
+	}
+
+	block->data = moved;
+	CHECK((uintptr_t) block->data % 8 == 0);
+	CHECK(intact(block, block->size < size ? block->size : size));
+	block->size = size;
+	fill(block);
+}
+
+int main(void)
+{
+	arena_stats_t start;
+	arena_stats_t stats;
+
+	printf("Arena of %u bytes, %d blocks for %d rounds.\n", ARENA_SIZE, BLOCKS, ROUNDS);
+	arena_get_stats(&start);
+
+	// Random allocations, reallocations and frees, most of them succeeding.
+	size_t succeeded = 0;
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		block_t *block = &blocks[next_random() % BLOCKS];
+
+		if (block->data == NULL)
+		{
+			allocate(block, random_size());
+			succeeded += block->data != NULL;
+		}
+		else if (next_random() % 4 == 0)
+		{
+			resize(block, random_size());
+		}
+		else
+		{
+			release(block);
+		}
+	}
+	CHECK(succeeded > ROUNDS / 4);
+
+	// The SDK frees and allocates its buffers again with the same sizes,
+	// which must not fragment the arena any further.
+	arena_get_stats(&stats);
+	size_t largest = stats.largest_free;
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		block_t *block = &blocks[next_random() % BLOCKS];
+		if (block->data == NULL)
+			continue;
+
+		size_t size = block->size;
+		release(block);
+		allocate(block, size);
+		CHECK(block->data != NULL);
+	}
+	arena_get_stats(&stats);
+	CHECK(stats.largest_free >= largest);
+
+	// Everything freed merges back into one block.
+	for (int i = 0; i < BLOCKS; i++)
+	{
+		if (blocks[i].data)
+			release(&blocks[i]);
+	}
+	arena_get_stats(&stats);
+	CHECK(stats.used == start.used);
+	CHECK(stats.allocations == start.allocations);
+	CHECK(stats.largest_free == start.largest_free);
+	CHECK(stats.peak > start.used);
+
+	// Freeing twice is ignored, too large an allocation fails and is counted.
+	size_t failures = stats.failures;
+	void *pointer = arena_alloc(100);
+	arena_free(pointer);
+	arena_free(pointer);
+	arena_get_stats(&stats);
+	CHECK(stats.allocations == start.allocations);
+	CHECK(arena_alloc(ARENA_SIZE) == NULL);
+	arena_get_stats(&stats);
+	CHECK(stats.failures == failures + 1);
+
+	printf("Peak of %u bytes, %u allocations failed.\n", (unsigned) stats.peak, (unsigned) stats.failures);
+
+	return check_result();
+}
@@ -0,0 +1,155 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file beamformer_test.cpp
+ *
+ *  @brief Test of `pipeline::DelayAndSum`. A broadband source is heard by
+ *  two microphones, the second one a known number of frames before the
+ *  first one, each with its own noise. The beamformer must track that delay
+ *  within every lag it covers, with and without decimation, and its output
+ *  must be the source aligned on the first microphone, continuous from one
+ *  period to the next. Summing the aligned channels must halve the power of
+ *  the uncorrelated noise, 3dB of gain, while the source keeps its level.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdint.h>
+
+#include "check.h"
+#include "pipeline.hpp"
+
+#define FRAMES		512
+#define MAX_DELAY	4
+#define PERIODS		16
+
+// Amplitudes of the source and of the noise of each microphone.
+#define SOURCE		8000
+#define NOISE		2000
+
+using layout_t = pipeline::Interleaved<2, 0>;
+
+template <unsigned Decimation>
+using beamformer_t = pipeline::DelayAndSum<pipeline::Int16, layout_t, FRAMES, Decimation, MAX_DELAY>;
+
+// xorshift32, the same sequence on every run.
+static uint32_t state = 2463534242u;
+
+static int16_t next_random(int amplitude)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return static_cast<int16_t>(static_cast<int32_t>(state % (2 * amplitude + 1)) - amplitude);
+}
+
+/*
+ * The source over `PERIODS` periods and `MAX_DELAY` frames either side, and
+ * the noise of both microphones.
+ */
+static int16_t source[MAX_DELAY + PERIODS * FRAMES + MAX_DELAY];
+static int16_t noise[2][PERIODS * FRAMES];
+
+static void generate(bool noisy)
+{
+	for (auto &sample : source)
+		sample = next_random(SOURCE);
+
+	for (auto &channel : noise)
+	{
+		for (auto &sample : channel)
+			sample = noisy ? next_random(NOISE) : 0;
+	}
+}
+
+// Source heard by the first microphone at `frame`.
+static int16_t heard(long frame)
+{
+	return source[MAX_DELAY + frame];
+}
+
+/*
+ * Interleave the `period` heard by both microphones, the second one `delay`
+ * frames before the first one.
+ */
+static void record(uint16_t *buffer, int period, int delay)
+{
+	for (int i = 0; i < FRAMES; i++)
+	{
+		long frame = static_cast<long>(period) * FRAMES + i;
+		buffer[2 * i] = static_cast<uint16_t>(heard(frame) + noise[0][frame]);
+		buffer[2 * i + 1] = static_cast<uint16_t>(heard(frame + delay) + noise[1][frame]);
+	}
+}
+
+/*
+ * Run the periods through the beamformer and check it tracks `delay`. The
+ * output should then be the source as the first microphone hears it, late
+ * by the delay when the second one lags behind. Returns the power of what is
+ * left of the output once that is taken out, over the second half of the
+ * periods.
+ */
+template <unsigned Decimation>
+static double run(int delay, bool noisy)
+{
+	static beamformer_t<Decimation> beamformer;
+	static uint16_t buffer[2 * FRAMES];
+	static float out[FRAMES / Decimation];
+	int late = delay < 0 ? -delay : 0;
+	double residual = 0;
+	long count = 0;
+
+	generate(noisy);
+	beamformer.reset();
+
+	for (int period = 0; period < PERIODS; period++)
+	{
+		record(buffer, period, delay);
+		beamformer.process(buffer, out);
+
+		if (period < PERIODS / 2)
+			continue;
+
+		for (size_t i = 0; i < FRAMES / Decimation; i++)
+		{
+			double expected = 0;
+			for (unsigned j = 0; j < Decimation; j++)
+				expected += heard(static_cast<long>(period) * FRAMES + i * Decimation + j - late);
+			expected /= Decimation * 32768.0;
+
+			double error = out[i] - expected;
+			residual += error * error;
+			count++;
+		}
+	}
+
+	CHECK(beamformer.delay() == delay);
+
+	return residual / count;
+}
+
+int main(void)
+{
+	// Without noise the output is the source, exactly aligned.
+	for (int delay = -MAX_DELAY; delay <= MAX_DELAY; delay++)
+	{
+		CHECK(run<1>(delay, false) < 1e-12);
+		CHECK(run<2>(delay, false) < 1e-12);
+	}
+
+	// The noise of each microphone, uniform, has a power of NOISE^2 / 3.
+	// Summing the aligned channels halves it.
+	double single = static_cast<double>(NOISE) * NOISE / 3 / (32768.0 * 32768.0);
+	for (int delay = -MAX_DELAY; delay <= MAX_DELAY; delay++)
+	{
+		double gain = 10 * log10(single / run<1>(delay, true));
+		CHECK(gain > 2.8 && gain < 3.2);
+	}
+
+	double gain = 10 * log10(single / run<1>(3, true));
+	printf("Beam gain of %.2f dB on the noise of the microphones.\n", gain);
+
+	return check_result();
+}
@@ -0,0 +1,27 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/*
+ * Checks of the host tests. A failed check is printed and counted, the test
+ * goes on and returns `check_result()` from main.
+ */
+static unsigned check_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			check_failures++; \
+		} \
+	} while (0)
+
+static inline int check_result(void)
+{
+	printf("%s: %u checks failed.\n", check_failures ? "FAILED" : "Passed", check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,217 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file dma_buffer_test.c
+ *
+ *  @brief Test of the cache maintenance of the STM32F746G example, its
+ *  dma_buffer.c built for the host over a mock of the CMSIS functions which
+ *  records the lines cleaned and invalidated. The areas are checked to be
+ *  rounded to whole cache lines and skipped in the non cacheable pool. Run
+ *  through the pipeline as on the board, every recorded period must be
+ *  invalidated after the DMA wrote it and before `loop` reads it, and every
+ *  played period cleaned once the CPU wrote it and before the DMA reads it.
+ *
+ *  The addresses are cut to 32 bits by dma_buffer.c as on the board, the
+ *  mock compares them with the buffers of the test cut the same way.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "dma_buffer.h"
+#include "main.h"
+#include "pipeline.h"
+
+#define LINE_SIZE	32
+
+#define PERIODS		6
+
+typedef enum {
+	CALL_CLEAN,
+	CALL_INVALIDATE,
+} call_type_t;
+
+typedef struct {
+	call_type_t type;
+	uint32_t start;
+	int32_t length;
+} call_t;
+
+static uint16_t record_buffer[PIPELINE_BUFFER_LENGTH] __attribute__((aligned(LINE_SIZE)));
+static uint16_t play_buffer[PIPELINE_BUFFER_LENGTH] __attribute__((aligned(LINE_SIZE)));
+static float float_buffer[PIPELINE_FLOAT_LENGTH];
+static uint8_t lines[4 * LINE_SIZE] __attribute__((aligned(LINE_SIZE)));
+
+static call_t calls[8];
+static unsigned call_count = 0;
+
+// Half of the buffers the DMA is done with, and what happened to it since.
+static uint8_t recorded_half = 0;
+static uint8_t played_half = 0;
+static bool invalidated = false;
+static bool looped = false;
+static bool cleaned = false;
+static int16_t sample = 0;
+
+static uint32_t address_of(const void *pointer)
+{
+	return (uint32_t) (uintptr_t) pointer;
+}
+
+static bool covers(const call_t *call, const void *area, size_t size)
+{
+	return call->start == address_of(area) && call->length == (int32_t) size;
+}
+
+static void record_call(call_type_t type, uint32_t *address, int32_t size)
+{
+	if (call_count < sizeof(calls) / sizeof(calls[0]))
+		calls[call_count] = (call_t) { type, (uint32_t) (uintptr_t) address, size };
+	call_count++;
+}
+
+void SCB_CleanDCache_by_Addr(uint32_t *address, int32_t size)
+{
+	record_call(CALL_CLEAN, address, size);
+
+	const uint16_t *period = &play_buffer[played_half * PIPELINE_BUFFER_LENGTH / 2];
+	if (address_of(address) != address_of(period))
+		return;
+
+	// The period is written back once `loop` filled it, and never twice.
+	CHECK(looped);
+	CHECK(!cleaned);
+	bool filled = true;
+	for (int i = 0; i < PIPELINE_BUFFER_LENGTH / 2; i++)
+		filled &= abs((int16_t) period[i] - sample) <= 1;
+	CHECK(filled);
+	cleaned = true;
+}
+
+void SCB_InvalidateDCache_by_Addr(uint32_t *address, int32_t size)
+{
+	record_call(CALL_INVALIDATE, address, size);
+
+	const uint16_t *period = &record_buffer[recorded_half * PIPELINE_BUFFER_LENGTH / 2];
+	if (address_of(address) != address_of(period))
+		return;
+
+	// The period is discarded from the cache before `loop` reads it.
+	CHECK(!looped);
+	CHECK(!invalidated);
+	invalidated = true;
+}
+
+static void loop(float *buffer, uint16_t length)
+{
+	looped = true;
+
+	if (pipeline_get_mode() == PIPELINE_LISTENING)
+	{
+		CHECK(invalidated);
+		return;
+	}
+
+	CHECK(!cleaned);
+	for (int i = 0; i < length; i++)
+		buffer[i] = sample / 32767.0f;
+}
+
+static void test_lines(void)
+{
+	// Rounded to the lines holding the area.
+	call_count = 0;
+	dma_buffer_clean(&lines[5], 10);
+	CHECK(call_count == 1 && calls[0].type == CALL_CLEAN && covers(&calls[0], lines, LINE_SIZE));
+
+	call_count = 0;
+	dma_buffer_invalidate(&lines[LINE_SIZE - 2], 4);
+	CHECK(call_count == 1 && calls[0].type == CALL_INVALIDATE && covers(&calls[0], lines, 2 * LINE_SIZE));
+
+	call_count = 0;
+	dma_buffer_clean(&lines[LINE_SIZE], 2 * LINE_SIZE);
+	CHECK(call_count == 1 && covers(&calls[0], &lines[LINE_SIZE], 2 * LINE_SIZE));
+
+	// Nothing to do for an empty area or in the non cacheable pool, unless
+	// the area goes past its end.
+	call_count = 0;
+	dma_buffer_clean(lines, 0);
+	dma_buffer_invalidate((void *) (uintptr_t) SRAM2_BASE, 1024);
+	dma_buffer_clean((const void *) (uintptr_t) (SRAM2_BASE + 16 * 1024 - LINE_SIZE), LINE_SIZE);
+	CHECK(call_count == 0);
+
+	dma_buffer_invalidate((void *) (uintptr_t) (SRAM2_BASE + 16 * 1024 - LINE_SIZE), 2 * LINE_SIZE);
+	CHECK(call_count == 1);
+}
+
+static void test_pipeline(void)
+{
+	static const pipeline_hal_t hal = {
+		.invalidate = dma_buffer_invalidate,
+		.clean = dma_buffer_clean,
+	};
+	static const pipeline_config_t config = {
+		.record_buffer = record_buffer,
+		.play_buffer = play_buffer,
+		.float_buffer = float_buffer,
+		.loop = loop,
+		.hal = &hal,
+	};
+
+	pipeline_init(&config);
+
+	// The record DMA fills a half, then the main loop processes it.
+	pipeline_set_mode(PIPELINE_LISTENING);
+	for (int period = 0; period < PERIODS; period++)
+	{
+		recorded_half = period % 2;
+		uint16_t *half = &record_buffer[recorded_half * PIPELINE_BUFFER_LENGTH / 2];
+		for (int i = 0; i < PIPELINE_BUFFER_LENGTH / 2; i++)
+			half[i] = (uint16_t) (int16_t) (i % 16 < 8 ? 4000 : -4000);
+
+		invalidated = looped = false;
+		call_count = 0;
+		pipeline_recorded(recorded_half);
+		pipeline_process();
+
+		CHECK(looped);
+		CHECK(call_count == 1 && calls[0].type == CALL_INVALIDATE);
+		CHECK(covers(&calls[0], half, PIPELINE_BUFFER_LENGTH));
+	}
+
+	// The play DMA is done with a half, the main loop fills it again.
+	pipeline_set_mode(PIPELINE_PLAYING);
+	for (int period = 0; period < PERIODS; period++)
+	{
+		played_half = period % 2;
+		sample = (int16_t) (1000 * (period + 1));
+
+		cleaned = looped = false;
+		call_count = 0;
+		pipeline_played(played_half);
+		pipeline_process();
+
+		CHECK(cleaned);
+		CHECK(call_count == 1 && calls[0].type == CALL_CLEAN);
+		CHECK(covers(&calls[0], &play_buffer[played_half * PIPELINE_BUFFER_LENGTH / 2], PIPELINE_BUFFER_LENGTH));
+	}
+}
+
+int main(void)
+{
+	// The buffers of the test must not look like the pool once cut to 32
+	// bits.
+	CHECK(address_of(lines) - SRAM2_BASE >= 32 * 1024);
+	CHECK(address_of(record_buffer) - SRAM2_BASE >= 32 * 1024);
+	CHECK(address_of(play_buffer) - SRAM2_BASE >= 32 * 1024);
+
+	test_lines();
+	test_pipeline();
+
+	return check_result();
+}
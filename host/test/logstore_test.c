@@ -0,0 +1,226 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file logstore_test.c
+ *
+ *  @brief Test of the log store over the flash mock. Records of a whole
+ *  sector each are written until the ring of sectors has wrapped around
+ *  several times, the records left must be the latest ones, in order and
+ *  intact, and every sector must have been erased as often as the others.
+ *  A record cut by a reset must be skipped when the store is mounted again,
+ *  the records after it going on in the next sector.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "flash_mock.h"
+#include "logstore.h"
+
+#define FLASH_PATH		"logstore-test.bin"
+
+#define RECORD_TYPE		7
+
+// Wraps of the ring of sectors written.
+#define WRAPS			3
+
+typedef struct {
+	uint32_t count;
+	uint32_t first;
+	uint32_t last;
+	bool ordered;
+	bool intact;
+} found_t;
+
+static const logstore_flash_t *flash = NULL;
+
+static uint8_t data[4096];
+
+// The data of every record depends on its sequence.
+static void fill(uint32_t sequence, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		data[i] = (uint8_t) (sequence * 31 + i);
+}
+
+static bool check_record(const logstore_record_t *record, void *context)
+{
+	found_t *found = context;
+	uint8_t byte;
+
+	if (found->count == 0)
+		found->first = record->sequence;
+	else if (record->sequence != found->last + 1)
+		found->ordered = false;
+	found->last = record->sequence;
+	found->count++;
+
+	for (uint32_t i = 0; i < record->length; i += 61)
+	{
+		if (!logstore_read(record, i, &byte, 1) || byte != (uint8_t) (record->sequence * 31 + i))
+			found->intact = false;
+	}
+	if (record->type != RECORD_TYPE)
+		found->intact = false;
+
+	return true;
+}
+
+static found_t find_records(void)
+{
+	found_t found = { .ordered = true, .intact = true };
+
+	logstore_iterate(check_record, &found);
+
+	return found;
+}
+
+static bool append(size_t length)
+{
+	logstore_stats_t stats;
+	logstore_get_stats(&stats);
+
+	fill(stats.next, length);
+	return logstore_append(RECORD_TYPE, data, length);
+}
+
+// Erases of the whole flash since it was last opened.
+static uint32_t total_erases(void)
+{
+	uint32_t erases = 0;
+
+	for (uint32_t i = 0; i < flash->size; i += flash->sector_size)
+		erases += flash_mock_erase_count(flash->address + i);
+
+	return erases;
+}
+
+/*
+ * Reset of the board: the flash is closed whatever it was doing and the
+ * store mounted again.
+ */
+static void reset(void)
+{
+	flash_mock_close();
+	flash = flash_mock_open(FLASH_PATH);
+	CHECK(flash != NULL);
+	CHECK(logstore_mount(flash));
+}
+
+static void test_wrap(void)
+{
+	logstore_stats_t stats;
+	uint32_t sectors = flash->size / flash->sector_size;
+	// A record filling a sector after its header.
+	size_t length = flash->sector_size - 2 * LOGSTORE_HEADER_SIZE;
+
+	for (uint32_t i = 0; i < WRAPS * sectors + sectors / 2; i++)
+	{
+		CHECK(append(length));
+		logstore_flush();
+	}
+
+	logstore_get_stats(&stats);
+	CHECK(stats.errors == 0);
+	CHECK(stats.sectors == sectors);
+	CHECK(stats.next == WRAPS * sectors + sectors / 2);
+	CHECK(stats.records == sectors);
+	CHECK(stats.first == stats.next - stats.records);
+
+	found_t found = find_records();
+	CHECK(found.count == stats.records);
+	CHECK(found.first == stats.first);
+	CHECK(found.last == stats.next - 1);
+	CHECK(found.ordered);
+	CHECK(found.intact);
+
+	// Every sector erased as many times as the others, give or take one.
+	uint32_t least = UINT32_MAX;
+	uint32_t most = 0;
+	for (uint32_t i = 0; i < sectors; i++)
+	{
+		uint32_t erases = flash_mock_erase_count(flash->address + i * flash->sector_size);
+		if (erases < least)
+			least = erases;
+		if (erases > most)
+			most = erases;
+	}
+	CHECK(least >= WRAPS);
+	CHECK(most - least <= 1);
+	CHECK(stats.erases == most);
+
+	// The same records are found once mounted again.
+	reset();
+	logstore_stats_t mounted;
+	logstore_get_stats(&mounted);
+	CHECK(mounted.records == stats.records);
+	CHECK(mounted.first == stats.first);
+	CHECK(mounted.next == stats.next);
+	CHECK(mounted.erases == stats.erases);
+}
+
+static void test_torn_record(void)
+{
+	logstore_stats_t before;
+	logstore_stats_t stats;
+
+	for (int i = 0; i < 3; i++)
+		CHECK(append(100));
+	logstore_flush();
+	logstore_get_stats(&before);
+
+	// Reset while the pages of a record are programmed, the header first.
+	CHECK(append(1000));
+	for (int i = 0; i < 6; i++)
+		logstore_process();
+	reset();
+
+	logstore_get_stats(&stats);
+	CHECK(stats.next == before.next);
+	CHECK(stats.records == before.records);
+
+	found_t found = find_records();
+	CHECK(found.count == before.records);
+	CHECK(found.last == before.next - 1);
+	CHECK(found.ordered);
+	CHECK(found.intact);
+
+	// The next records go on in the next sector, with the sequence of the
+	// record lost.
+	for (int i = 0; i < 3; i++)
+		CHECK(append(100));
+	logstore_flush();
+	CHECK(total_erases() == 1);
+
+	reset();
+	logstore_get_stats(&stats);
+	CHECK(stats.next == before.next + 3);
+	CHECK(stats.errors == 0);
+
+	found = find_records();
+	CHECK(found.last == before.next + 2);
+	CHECK(found.ordered);
+	CHECK(found.intact);
+}
+
+int main(void)
+{
+	remove(FLASH_PATH);
+	flash = flash_mock_open(FLASH_PATH);
+	CHECK(flash != NULL);
+	CHECK(logstore_mount(flash));
+
+	test_wrap();
+	test_torn_record();
+
+	flash_mock_close();
+	remove(FLASH_PATH);
+
+	return check_result();
+}
@@ -0,0 +1,302 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file pipeline_test.c
+ *
+ *  @brief Test of the periods the pipeline gives to `loop`, as the audio
+ *  interrupts and the mode switches of the boards come. Every period is
+ *  checked to reach `loop` once, in order and at its position in the audio:
+ *  the periods missed by the main loop are replayed from a history standing
+ *  in for the capture ring, and the ones recorded while playing are skipped
+ *  without being reported lost. With the gate, the periods it kept reach
+ *  `loop` at their own position when it opens again, and a chirp playing
+ *  from the start is never kept from it.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "pipeline.h"
+
+#define HISTORY_PERIODS		32
+
+// Most calls of `loop` checked in one step.
+#define MAX_CALLS			32
+
+typedef struct {
+	pipeline_mode_t mode;
+	uint32_t position;
+} call_t;
+
+static uint16_t record_buffer[PIPELINE_BUFFER_LENGTH];
+static uint16_t play_buffer[PIPELINE_BUFFER_LENGTH];
+static float float_buffer[PIPELINE_FLOAT_LENGTH];
+
+static uint16_t history[HISTORY_PERIODS][PIPELINE_BUFFER_LENGTH / 2];
+static uint32_t recorded = 0;
+static uint32_t played = 0;
+
+static call_t calls[MAX_CALLS];
+static unsigned call_count = 0;
+
+static bool skip = false;
+
+static void loop(float *buffer, uint16_t length)
+{
+	if (call_count < MAX_CALLS)
+		calls[call_count] = (call_t) { pipeline_get_mode(), pipeline_position() };
+	call_count++;
+}
+
+static bool can_skip(void)
+{
+	return skip;
+}
+
+static uint32_t recorded_count(void)
+{
+	return recorded;
+}
+
+static uint32_t replay(uint32_t first, uint32_t count, pipeline_period_t callback)
+{
+	uint32_t replayed = 0;
+
+	for (uint32_t index = first; replayed < count && index < recorded; index++, replayed++)
+	{
+		if (recorded - index > HISTORY_PERIODS)
+			break;
+		callback(history[index % HISTORY_PERIODS]);
+	}
+
+	return replayed;
+}
+
+/*
+ * Record interrupt: the next half of the record buffer holds a square wave
+ * of `amplitude`, in the band of the mock SDK, kept in the history.
+ */
+static void record_tone(int16_t amplitude)
+{
+	uint8_t half = recorded % 2;
+	uint16_t *period = &record_buffer[half * PIPELINE_BUFFER_LENGTH / 2];
+
+	for (int i = 0; i < PIPELINE_BUFFER_LENGTH / 2; i++)
+		period[i] = (uint16_t) (int16_t) ((i / 2) % 16 < 8 ? amplitude : -amplitude);
+
+	memcpy(history[recorded % HISTORY_PERIODS], period, sizeof(history[0]));
+	recorded++;
+
+	pipeline_recorded(half);
+}
+
+static void record(void)
+{
+	record_tone(8000);
+}
+
+static void play(void)
+{
+	pipeline_played(played % 2);
+	played++;
+}
+
+/*
+ * Process what is pending and check `loop` was given the periods recorded
+ * from `first` to `last` included.
+ */
+static void check_listened(uint32_t first, uint32_t last)
+{
+	call_count = 0;
+	pipeline_process();
+
+	CHECK(call_count == last - first + 1);
+	for (unsigned i = 0; i < call_count && i < MAX_CALLS; i++)
+	{
+		CHECK(calls[i].mode == PIPELINE_LISTENING);
+		CHECK(calls[i].position == (first + i) * PIPELINE_FLOAT_LENGTH);
+	}
+}
+
+static void start(void)
+{
+	static const pipeline_hal_t hal = {
+		.recorded_count = recorded_count,
+		.replay = replay,
+	};
+	static const pipeline_config_t config = {
+		.record_buffer = record_buffer,
+		.play_buffer = play_buffer,
+		.float_buffer = float_buffer,
+		.loop = loop,
+		.can_skip = can_skip,
+		.hal = &hal,
+	};
+
+	recorded = 0;
+	played = 0;
+	pipeline_init(&config);
+	pipeline_set_mode(PIPELINE_LISTENING);
+}
+
+static void test_modes(void)
+{
+	start();
+
+	// Every period decoded as soon as recorded.
+	for (uint32_t period = 0; period < 4; period++)
+	{
+		record();
+		check_listened(period, period);
+	}
+
+	// Three periods recorded before the main loop came back, the first two
+	// are replayed.
+	record();
+	record();
+	record();
+	check_listened(4, 6);
+
+	// Playing while the recording goes on, the period filled is played
+	// after the one the DMA is sending.
+	pipeline_set_mode(PIPELINE_PLAYING);
+	for (uint32_t period = 0; period < 4; period++)
+	{
+		record();
+		play();
+		call_count = 0;
+		pipeline_process();
+		CHECK(call_count == 1);
+		CHECK(calls[0].mode == PIPELINE_PLAYING);
+		CHECK(calls[0].position == (period + 2) * PIPELINE_FLOAT_LENGTH);
+	}
+
+	// Listening again with a period recorded right before: it is decoded
+	// alone, the ones recorded while playing are neither replayed nor lost.
+	record();
+	pipeline_set_mode(PIPELINE_LISTENING);
+	check_listened(11, 11);
+
+	record();
+	check_listened(12, 12);
+
+	// Then without a period pending.
+	pipeline_set_mode(PIPELINE_PLAYING);
+	pipeline_set_mode(PIPELINE_LISTENING);
+	record();
+	check_listened(13, 13);
+}
+
+/*
+ * Same with the gate, the SDK allowing the silent periods to be skipped.
+ */
+static void test_gate(void)
+{
+	start();
+	skip = true;
+
+	record();
+	check_listened(0, 0);
+
+	// Kept by the gate once it closed, only given to `loop` when it opens,
+	// the last `PIPELINE_GATE_PREROLL` of them first.
+	uint32_t period = 1;
+	for (; period < 64; period++)
+	{
+		record_tone(0);
+		call_count = 0;
+		pipeline_process();
+		if (call_count == 0)
+			break;
+		CHECK(calls[0].position == period * PIPELINE_FLOAT_LENGTH);
+	}
+	CHECK(period < 64);
+
+	for (period++; period < 64; period++)
+	{
+		record_tone(0);
+		call_count = 0;
+		pipeline_process();
+		CHECK(call_count == 0);
+	}
+
+	record();
+	check_listened(period - PIPELINE_GATE_PREROLL, period);
+	period++;
+
+	// Missed periods kept by the closed gate, then replayed when it opens.
+	for (int i = 0; i < 32; i++, period++)
+	{
+		record_tone(0);
+		pipeline_process();
+	}
+	record_tone(0);
+	record_tone(0);
+	record();
+	check_listened(period + 2 - PIPELINE_GATE_PREROLL, period + 2);
+	period += 3;
+
+	// Kept before playing, they are not given to `loop` when listening
+	// starts again and no period is reported lost.
+	for (int i = 0; i < 32; i++, period++)
+	{
+		record_tone(0);
+		pipeline_process();
+	}
+	pipeline_set_mode(PIPELINE_PLAYING);
+	for (int i = 0; i < 4; i++, period++)
+	{
+		record();
+		play();
+		pipeline_process();
+	}
+	record();
+	pipeline_set_mode(PIPELINE_LISTENING);
+	check_listened(period, period);
+
+	skip = false;
+}
+
+/*
+ * A chirp already playing when the board starts, longer than the gate holds,
+ * is not taken for the floor: every period of it reaches `loop`, then the
+ * gate closes on the silence after it.
+ */
+static void test_gate_start(void)
+{
+	start();
+	skip = true;
+
+	uint32_t period = 0;
+	for (; period < 64; period++)
+	{
+		record();
+		check_listened(period, period);
+	}
+
+	uint32_t given = 0;
+	for (int i = 0; i < 64; i++, period++)
+	{
+		record_tone(0);
+		call_count = 0;
+		pipeline_process();
+		given += call_count;
+	}
+	CHECK(given > 0 && given < 64);
+
+	skip = false;
+}
+
+int main(void)
+{
+	test_modes();
+	test_gate();
+	test_gate_start();
+
+	return check_result();
+}
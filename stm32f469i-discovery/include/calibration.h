@@ -0,0 +1,24 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Duration of the measurement of the sample clock, in seconds. The timer
+ * resolution and the interrupt latency give an error well below 1ppm after
+ * a few seconds.
+ */
+#ifndef CALIBRATION_SECONDS
+#define CALIBRATION_SECONDS	5
+#endif
+
+bool calibration_load(uint32_t sample_rate, float *correction);
+
+bool calibration_store(uint32_t sample_rate, float correction);
+
+void calibration_period(uint32_t frames);
+
+bool calibration_measure(uint32_t sample_rate, float *correction);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+
+void idle_init(uint32_t samples, uint32_t sample_rate);
+
+void idle_wait(void);
+
+uint32_t idle_period(void);
+
+uint32_t idle_period_cycles(void);
+
+#endif
@@ -6,6 +6,8 @@
 // Here to provide LCD colors in application.c
 #include "stm32469i_discovery_lcd.h"
 
+#include "screen.h"
+
 bool init_audio_input(void);
 
 bool init_audio_output(void);
@@ -14,6 +16,8 @@ void error_handler(const char *function, char *file, int line);
 
 void set_screen_color(uint32_t color);
 
+void set_screen(const screen_t *screen);
+
 void on_screen_touch(void);
 
 void display_message(char *message, uint32_t color);
@@ -0,0 +1,18 @@
+#ifndef PIPELINE_CONF_H
+#define PIPELINE_CONF_H
+
+/*
+ * The pipeline runs from flash. A period is five blocks of the PDM filter,
+ * PCM_OUT_SIZE samples of interleaved stereo each.
+ */
+#define PIPELINE_PERIOD_LENGTH	220
+
+// Band-pass and gain control ahead of the SDK, a few tens of cycles a sample.
+#define PIPELINE_PREPROCESS		1
+
+// The SDK only runs while the band is louder than the room. The periods are
+// short, 16 of them hold the 80ms before.
+#define PIPELINE_GATE			1
+#define PIPELINE_GATE_PREROLL	16
+
+#endif
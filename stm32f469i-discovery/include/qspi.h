@@ -0,0 +1,12 @@
+#ifndef QSPI_H
+#define QSPI_H
+
+#include <stdbool.h>
+
+#include "logstore.h"
+
+bool qspi_init(void);
+
+extern const logstore_flash_t qspi_log_flash;
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdint.h>
+
+/*
+ * Full screen image in flash, generated by tools/make_screens.py into
+ * src/screen_data.c: a plain background, and a banner of `banner_height` lines
+ * at the bottom with the name of the state. The banner is an alpha mask, 4
+ * bits a pixel, drawn in the background color.
+ */
+typedef struct {
+	uint16_t width;
+	uint16_t height;
+	uint32_t background;
+	uint16_t banner_height;
+	const uint8_t *banner;
+} screen_t;
+
+extern const screen_t screen_listening;
+extern const screen_t screen_receiving;
+extern const screen_t screen_received;
+extern const screen_t screen_failed;
+extern const screen_t screen_sending;
+extern const screen_t screen_sent;
+extern const screen_t screen_calibrating;
+
+void screen_show(const screen_t *screen);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "eventlog.h"
+
+bool timer_init(void);
+
+uint32_t timer_micros(void);
+
+extern const eventlog_clock_t timer_clock;
+
+#endif
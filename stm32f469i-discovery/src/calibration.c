@@ -0,0 +1,298 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file calibration.c
+ *
+ *  @brief Frequency correction of the SDK for any sample rate. The audio
+ *  clock comes from the PLLI2S, whose dividers rarely give the exact sample
+ *  rate requested, so the audio recorded runs slightly fast or slow and the
+ *  SDK detects every frequency off by the same ratio.
+ *
+ *  The ratio is measured by counting the frames recorded against TIM2,
+ *  clocked from the main PLL, over a few seconds. The HSE crystal clocks
+ *  both PLLs, its own error cancels out.
+ *
+ *  The corrections are kept in the last sector of the flash, left out of the
+ *  firmware by the linker script, so that reflashing the board keeps them.
+ *  Records are appended one after the other, the latest one for a sample
+ *  rate wins, and the sector is only erased once full.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "main.h"
+
+#include "calibration.h"
+
+#define CALIBRATION_MAGIC	0x43485243
+
+// Sector holding the records, see the CONFIG region of the linker script.
+#define CALIBRATION_SECTOR	FLASH_SECTOR_23
+
+/*
+ * Corrections further than this from 1 come from a broken measurement, such
+ * as the recording stopping, rather than from the PLL.
+ */
+#define CALIBRATION_TOLERANCE	0.05f
+
+// Sample rates kept when the sector is erased to make room.
+#define CALIBRATION_MAX_RATES	16
+
+typedef struct {
+	uint32_t magic;
+	uint32_t sample_rate;
+	float correction;
+	// Complement of the other words XORed, catches a record half written.
+	uint32_t check;
+} calibration_record_t;
+
+extern const uint8_t _sconfig;
+extern const uint8_t _econfig;
+
+#define RECORDS		((const calibration_record_t *) &_sconfig)
+#define MAX_RECORDS	((uint32_t) (&_econfig - &_sconfig) / sizeof(calibration_record_t))
+
+static TIM_HandleTypeDef timer;
+
+// Written by the audio interrupt while measuring.
+static volatile bool measuring = false;
+static volatile uint32_t periods = 0;
+static volatile uint32_t frames = 0;
+static volatile uint32_t first_tick = 0;
+static volatile uint32_t last_tick = 0;
+
+static uint32_t record_check(const calibration_record_t *record)
+{
+	uint32_t correction;
+	memcpy(&correction, &record->correction, sizeof(correction));
+
+	return ~(record->magic ^ record->sample_rate ^ correction);
+}
+
+static bool record_valid(const calibration_record_t *record)
+{
+	return record->magic == CALIBRATION_MAGIC && record->check == record_check(record);
+}
+
+/*
+ * Index of the first erased record, `MAX_RECORDS` when the sector is full.
+ */
+static uint32_t free_record(void)
+{
+	uint32_t i = 0;
+
+	while (i < MAX_RECORDS && RECORDS[i].magic != 0xFFFFFFFF)
+		i++;
+
+	return i;
+}
+
+/*
+ * The ART accelerator may still hold the words read before they were
+ * programmed.
+ */
+static void flush_flash_cache(void)
+{
+	__HAL_FLASH_DATA_CACHE_DISABLE();
+	__HAL_FLASH_DATA_CACHE_RESET();
+	__HAL_FLASH_DATA_CACHE_ENABLE();
+}
+
+static bool write_record(uint32_t index, uint32_t sample_rate, float correction)
+{
+	calibration_record_t record = {
+		.magic = CALIBRATION_MAGIC,
+		.sample_rate = sample_rate,
+		.correction = correction,
+	};
+	record.check = record_check(&record);
+
+	const uint32_t *words = (const uint32_t *) &record;
+	uint32_t address = (uint32_t) &RECORDS[index];
+
+	for (uint32_t i = 0; i < sizeof(record) / sizeof(uint32_t); i++)
+	{
+		if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i * sizeof(uint32_t), words[i]) != HAL_OK)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Erase the sector, keeping the latest correction of every sample rate.
+ */
+static bool compact(uint32_t *next)
+{
+	uint32_t rates[CALIBRATION_MAX_RATES];
+	float corrections[CALIBRATION_MAX_RATES];
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; i < MAX_RECORDS; i++)
+	{
+		const calibration_record_t *record = &RECORDS[i];
+		if (!record_valid(record))
+			continue;
+
+		uint32_t j = 0;
+		while (j < count && rates[j] != record->sample_rate)
+			j++;
+
+		if (j == count)
+		{
+			if (count == CALIBRATION_MAX_RATES)
+				continue;
+			rates[count++] = record->sample_rate;
+		}
+		corrections[j] = record->correction;
+	}
+
+	FLASH_EraseInitTypeDef erase = {
+		.TypeErase = FLASH_TYPEERASE_SECTORS,
+		.Sector = CALIBRATION_SECTOR,
+		.NbSectors = 1,
+		.VoltageRange = FLASH_VOLTAGE_RANGE_3,
+	};
+	uint32_t error = 0;
+
+	if (HAL_FLASHEx_Erase(&erase, &error) != HAL_OK)
+		return false;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!write_record(i, rates[i], corrections[i]))
+			return false;
+	}
+
+	*next = count;
+	return true;
+}
+
+/*
+ * Latest correction stored for `sample_rate`. Returns false if the board has
+ * never been calibrated at this rate.
+ */
+bool calibration_load(uint32_t sample_rate, float *correction)
+{
+	bool found = false;
+
+	for (uint32_t i = 0; i < MAX_RECORDS; i++)
+	{
+		const calibration_record_t *record = &RECORDS[i];
+		if (record->magic == 0xFFFFFFFF)
+			break;
+
+		if (record_valid(record) && record->sample_rate == sample_rate)
+		{
+			*correction = record->correction;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Append the correction of `sample_rate` to the sector, erasing it first if
+ * it is full. The erase stalls the second bank for about a second, the
+ * firmware runs from the first one.
+ */
+bool calibration_store(uint32_t sample_rate, float correction)
+{
+	uint32_t next = free_record();
+	bool stored = false;
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+			FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+	if (next < MAX_RECORDS || compact(&next))
+		stored = write_record(next, sample_rate, correction);
+
+	HAL_FLASH_Lock();
+	flush_flash_cache();
+
+	float check = 0;
+	return stored && calibration_load(sample_rate, &check) && check == correction;
+}
+
+/*
+ * Called from the audio interrupt once `count` frames have been recorded.
+ * The first call only starts the measurement, the frames it accounts for
+ * were recorded before.
+ */
+void calibration_period(uint32_t count)
+{
+	if (!measuring)
+		return;
+
+	uint32_t tick = __HAL_TIM_GET_COUNTER(&timer);
+
+	if (periods == 0)
+		first_tick = tick;
+	else
+		frames += count;
+
+	last_tick = tick;
+	periods++;
+}
+
+/*
+ * Measure the correction at `sample_rate`, the audio input being recorded.
+ * Blocks for `CALIBRATION_SECONDS`.
+ */
+bool calibration_measure(uint32_t sample_rate, float *correction)
+{
+	// TIM2 is on APB1, its clock is twice PCLK1 whenever APB1 is divided.
+	// The governor changes the prescalers but not this clock.
+	uint32_t clock = HAL_RCC_GetPCLK1Freq();
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+		clock *= 2;
+
+	__HAL_RCC_TIM2_CLK_ENABLE();
+
+	timer.Instance = TIM2;
+	timer.Init.Prescaler = 0;
+	timer.Init.CounterMode = TIM_COUNTERMODE_UP;
+	timer.Init.Period = 0xFFFFFFFF;
+	timer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+
+	if (HAL_TIM_Base_Init(&timer) != HAL_OK || HAL_TIM_Base_Start(&timer) != HAL_OK)
+		return false;
+
+	periods = 0;
+	frames = 0;
+	measuring = true;
+
+	uint32_t start = HAL_GetTick();
+	while (HAL_GetTick() - start < CALIBRATION_SECONDS * 1000)
+		__WFI();
+
+	measuring = false;
+
+	HAL_TIM_Base_Stop(&timer);
+	HAL_TIM_Base_DeInit(&timer);
+	__HAL_RCC_TIM2_CLK_DISABLE();
+
+	uint32_t ticks = last_tick - first_tick;
+	if (frames == 0 || ticks == 0)
+	{
+		printf("No audio recorded during the calibration.\n");
+		return false;
+	}
+
+	double rate = (double) frames * clock / ticks;
+	float measured = (float) (rate / sample_rate);
+
+	printf("Sample rate: %lu Hz measured for %lu Hz, correction %.7f.\n",
+			(uint32_t) (rate + 0.5), sample_rate, measured);
+
+	if (measured < 1.0f - CALIBRATION_TOLERANCE || measured > 1.0f + CALIBRATION_TOLERANCE)
+		return false;
+
+	*correction = measured;
+	return true;
+}
@@ -0,0 +1,151 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file console.c
+ *
+ *  @brief Text console drawn on the LCD. Messages are wrapped into lines and
+ *  only the frame buffer keeps them. Once the screen is full, it is scrolled
+ *  up by one text line with a DMA2D copy and only the new line is rendered,
+ *  so printing costs one line whatever the number of lines on screen.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "main.h"
+#include "console.h"
+#include "lcd_dma2d.h"
+
+/*
+ * Upper bounds of the console, the actual size depends on the screen and font
+ * sizes and is computed in `console_init()`.
+ */
+#define CONSOLE_MAX_LINES	32
+#define CONSOLE_MAX_COLUMNS	96
+
+// Number of lines currently displayed.
+static uint8_t line_count = 0;
+
+static uint8_t rows = 0;
+static uint8_t columns = 0;
+static uint16_t line_height = 0;
+static uint32_t background = LCD_COLOR_WHITE;
+
+/*
+ * Render `text` in `color` on the screen row `row`.
+ */
+static void draw_line(uint8_t row, const char *text, uint32_t color)
+{
+	uint32_t width = BSP_LCD_GetXSize();
+	uint32_t *address = (uint32_t *) LCD_FB_START_ADDRESS + row * line_height * width;
+
+	lcd_dma2d_fill(address, width, line_height, 0, background);
+	lcd_dma2d_wait();
+
+	// The BSP draws characters with the CPU, including their background.
+	uint32_t save_text_color = BSP_LCD_GetTextColor();
+	uint32_t save_back_color = BSP_LCD_GetBackColor();
+	BSP_LCD_SetTextColor(color);
+	BSP_LCD_SetBackColor(background);
+	BSP_LCD_DisplayStringAtLine(row, (uint8_t *) text);
+	BSP_LCD_SetTextColor(save_text_color);
+	BSP_LCD_SetBackColor(save_back_color);
+}
+
+/*
+ * Move every text line one row up, dropping the top one.
+ */
+static void scroll_up(void)
+{
+	uint32_t width = BSP_LCD_GetXSize();
+	uint32_t *top = (uint32_t *) LCD_FB_START_ADDRESS;
+
+	lcd_dma2d_copy(top + line_height * width, top, width, (rows - 1) * line_height, 0);
+
+	line_count--;
+}
+
+/*
+ * Append `length` characters of `text` as a new line at the bottom.
+ */
+static void push_line(const char *text, size_t length, uint32_t color)
+{
+	char line[CONSOLE_MAX_COLUMNS + 1];
+
+	if (line_count == rows)
+		scroll_up();
+
+	memcpy(line, text, length);
+	line[length] = '\0';
+
+	draw_line(line_count, line, color);
+	line_count++;
+}
+
+/*
+ * Compute the console geometry from the current LCD font, for the `height`
+ * top lines of the screen. Must be called after the LCD has been initialised
+ * and its font set.
+ */
+void console_init(uint16_t height)
+{
+	sFONT *font = BSP_LCD_GetFont();
+
+	line_height = font->Height;
+
+	uint32_t max_rows = height / font->Height;
+	rows = max_rows > CONSOLE_MAX_LINES ? CONSOLE_MAX_LINES : max_rows;
+
+	uint32_t max_columns = BSP_LCD_GetXSize() / font->Width;
+	columns = max_columns > CONSOLE_MAX_COLUMNS ? CONSOLE_MAX_COLUMNS : max_columns;
+
+	background = BSP_LCD_GetBackColor();
+	line_count = 0;
+}
+
+/*
+ * Empty the console without touching the screen, for when something else has
+ * just been drawn on it. The next message will be displayed on the first line
+ * with `back_color` as background.
+ */
+void console_reset(uint32_t back_color)
+{
+	background = back_color;
+	line_count = 0;
+}
+
+/*
+ * Fill the whole screen with `back_color` and empty the console.
+ */
+void console_clear(uint32_t back_color)
+{
+	lcd_dma2d_fill((uint32_t *) LCD_FB_START_ADDRESS, BSP_LCD_GetXSize(), BSP_LCD_GetYSize(), 0, back_color);
+
+	console_reset(back_color);
+}
+
+/*
+ * Print a message in `color`, wrapping it on as many lines as needed.
+ */
+void console_print(const char *message, uint32_t color)
+{
+	size_t message_length = strlen(message);
+
+	// An empty message still takes a line.
+	if (message_length == 0)
+	{
+		push_line(message, 0, color);
+		return;
+	}
+
+	for (size_t offset = 0; offset < message_length; offset += columns)
+	{
+		size_t length = message_length - offset;
+		if (length > columns)
+			length = columns;
+
+		push_line(message + offset, length, color);
+	}
+}
@@ -0,0 +1,36 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file crc.c
+ *
+ *  @brief The CRC unit of the core, which only computes the CRC-32 with the
+ *  polynomial 0x04C11DB7, initial value 0xFFFFFFFF, over 32 bits words and
+ *  without reflection. Used to check the frames of telemetry.c.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+
+#include "crc.h"
+
+static CRC_HandleTypeDef crc;
+
+bool crc_init(void)
+{
+	__HAL_RCC_CRC_CLK_ENABLE();
+
+	crc.Instance = CRC;
+
+	return HAL_CRC_Init(&crc) == HAL_OK;
+}
+
+/*
+ * CRC-32 of `count` words, started over at every call.
+ */
+uint32_t crc_compute(const uint32_t *words, size_t count)
+{
+	// The HAL only reads the words, it takes a mutable pointer anyway.
+	return HAL_CRC_Calculate(&crc, (uint32_t *) words, count);
+}
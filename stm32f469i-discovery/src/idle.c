@@ -0,0 +1,114 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file idle.c
+ *
+ *  @brief Sleep between audio periods and account for the time spent
+ *  processing them. The core sleeps with WFI until the next interrupt (DMA
+ *  half or complete transfer, touch screen, button or SysTick) and the DWT
+ *  cycle counter measures the active cycles of every audio period.
+ *
+ *  The cycle counter may or may not run while the core sleeps depending on
+ *  whether a debugger is attached, so the cycles spent in WFI are measured
+ *  and subtracted from the period rather than relied upon.
+ *
+ *  The core clock is changed at run time by the governor, so the length of a
+ *  period in cycles is derived from `SystemCoreClock` every time rather than
+ *  computed once, and the load is accumulated per period as a fraction.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+#include "idle.h"
+#include "telemetry.h"
+
+// Number of audio periods between two reports on the serial line.
+#define IDLE_REPORT_PERIODS	500
+
+// Length of an audio period.
+static uint32_t period_samples = 0;
+static uint32_t period_rate = 0;
+
+static uint32_t period_start = 0;
+static uint32_t period_sleep = 0;
+
+static uint32_t report_periods = 0;
+static float report_load = 0;
+static float report_peak = 0;
+static uint32_t report_peak_cycles = 0;
+
+/*
+ * Start the cycle counter. An audio period lasts `samples` samples at
+ * `sample_rate`.
+ */
+void idle_init(uint32_t samples, uint32_t sample_rate)
+{
+	period_samples = samples;
+	period_rate = sample_rate;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	period_start = DWT->CYCCNT;
+}
+
+/*
+ * Sleep until the next interrupt. Must be called with interrupts disabled,
+ * right after having checked that nothing is left to process, so that an
+ * interrupt happening after the check still wakes the core up. The interrupt
+ * is serviced once the caller enables them again.
+ */
+void idle_wait(void)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	__DSB();
+	__WFI();
+
+	period_sleep += DWT->CYCCNT - start;
+}
+
+/*
+ * Length of an audio period in cycles at the current core clock.
+ */
+uint32_t idle_period_cycles(void)
+{
+	return (uint64_t) SystemCoreClock * period_samples / period_rate;
+}
+
+/*
+ * Called once an audio period has been processed. Returns the number of
+ * cycles the core has been active during that period.
+ */
+uint32_t idle_period(void)
+{
+	uint32_t now = DWT->CYCCNT;
+	uint32_t active = now - period_start - period_sleep;
+	uint32_t cycles = idle_period_cycles();
+
+	period_start = now;
+	period_sleep = 0;
+
+	float load = (float) active / cycles;
+	report_load += load;
+	if (load > report_peak)
+	{
+		report_peak = load;
+		report_peak_cycles = active;
+	}
+
+	if (++report_periods < IDLE_REPORT_PERIODS)
+		return active;
+
+	telemetry_load(report_load / report_periods, report_peak, report_peak_cycles, cycles);
+
+	report_periods = 0;
+	report_load = 0;
+	report_peak = 0;
+	report_peak_cycles = 0;
+
+	return active;
+}
@@ -0,0 +1,205 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file lcd_dma2d.c
+ *
+ *  @brief Thin wrapper around the DMA2D to fill and move rectangles of the
+ *  ARGB8888 frame buffer without the CPU. Transfers are started and left
+ *  running, so any code drawing into the frame buffer with the CPU must call
+ *  `lcd_dma2d_wait()` first. One transfer can wait for the one in flight,
+ *  it is started by the transfer complete interrupt, so drawing a screen
+ *  never waits for the DMA2D.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+
+#include "main.h"
+#include "lcd_dma2d.h"
+
+/*
+ * A full screen copy reads and writes the whole frame buffer in SDRAM, which
+ * takes a few milliseconds while the LTDC is also fetching from it.
+ */
+#define LCD_DMA2D_TIMEOUT	100
+
+// Below the audio interrupts.
+#define LCD_DMA2D_IRQ_PRIORITY	0x0F
+
+typedef struct {
+	uint32_t mode;
+	uint32_t input_mode;
+	// Color of the fill, or foreground color of an alpha mask.
+	uint32_t color;
+	uint32_t source;
+	uint32_t destination;
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset;
+} transfer_t;
+
+DMA2D_HandleTypeDef lcd_dma2d_handle;
+
+// Transfer started once the one in flight is done.
+static transfer_t queued;
+static volatile bool is_queued = false;
+
+static void start(const transfer_t *transfer)
+{
+	lcd_dma2d_handle.Instance = DMA2D;
+	lcd_dma2d_handle.Init.Mode = transfer->mode;
+	lcd_dma2d_handle.Init.ColorMode = DMA2D_OUTPUT_ARGB8888;
+	lcd_dma2d_handle.Init.OutputOffset = transfer->offset;
+
+	if (HAL_DMA2D_Init(&lcd_dma2d_handle) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+
+	uint32_t source = transfer->color;
+	if (transfer->mode != DMA2D_R2M)
+	{
+		// The alpha masks only give the alpha, the color is the one of the
+		// foreground register.
+		lcd_dma2d_handle.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+		lcd_dma2d_handle.LayerCfg[1].InputAlpha = transfer->input_mode == DMA2D_INPUT_ARGB8888 ? 0xFF : transfer->color;
+		lcd_dma2d_handle.LayerCfg[1].InputColorMode = transfer->input_mode;
+		lcd_dma2d_handle.LayerCfg[1].InputOffset = transfer->offset;
+
+		if (HAL_DMA2D_ConfigLayer(&lcd_dma2d_handle, 1) != HAL_OK)
+			error_handler(__func__, __FILE__, __LINE__);
+
+		source = transfer->source;
+	}
+
+	if (HAL_DMA2D_Start_IT(&lcd_dma2d_handle, source, transfer->destination, transfer->width, transfer->height) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+}
+
+static void transfer_complete(DMA2D_HandleTypeDef *handle)
+{
+	if (is_queued)
+	{
+		is_queued = false;
+		start(&queued);
+	}
+}
+
+static void transfer_error(DMA2D_HandleTypeDef *handle)
+{
+	error_handler(__func__, __FILE__, __LINE__);
+}
+
+/*
+ * Start `transfer` now if the DMA2D is idle, or once the transfer in flight
+ * is done. Only waits when a transfer is already queued.
+ */
+static void submit(const transfer_t *transfer)
+{
+	uint32_t start_tick = HAL_GetTick();
+	while (is_queued)
+	{
+		if (HAL_GetTick() - start_tick > LCD_DMA2D_TIMEOUT)
+			error_handler(__func__, __FILE__, __LINE__);
+	}
+
+	// The transfer in flight must not complete between the check and the
+	// queueing.
+	HAL_NVIC_DisableIRQ(DMA2D_IRQn);
+	if (lcd_dma2d_handle.State == HAL_DMA2D_STATE_BUSY)
+	{
+		queued = *transfer;
+		is_queued = true;
+	}
+	else
+	{
+		start(transfer);
+	}
+	HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+}
+
+/*
+ * Enable the transfer complete interrupt, once the LCD has started the clock
+ * of the DMA2D.
+ */
+void lcd_dma2d_init(void)
+{
+	lcd_dma2d_handle.XferCpltCallback = transfer_complete;
+	lcd_dma2d_handle.XferErrorCallback = transfer_error;
+
+	HAL_NVIC_SetPriority(DMA2D_IRQn, LCD_DMA2D_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+}
+
+/*
+ * Block until the transfer in flight and the one queued, if any, are done.
+ */
+void lcd_dma2d_wait(void)
+{
+	uint32_t start_tick = HAL_GetTick();
+
+	while (is_queued || lcd_dma2d_handle.State == HAL_DMA2D_STATE_BUSY)
+	{
+		if (HAL_GetTick() - start_tick > 2 * LCD_DMA2D_TIMEOUT)
+			error_handler(__func__, __FILE__, __LINE__);
+	}
+}
+
+/*
+ * Fill a `width` x `height` rectangle starting at `address` with `color`.
+ * `offset` is the number of pixels to skip at the end of each line.
+ */
+void lcd_dma2d_fill(uint32_t *address, uint32_t width, uint32_t height, uint32_t offset, uint32_t color)
+{
+	transfer_t transfer = {
+		.mode = DMA2D_R2M,
+		.color = color,
+		.destination = (uint32_t) address,
+		.width = width,
+		.height = height,
+		.offset = offset,
+	};
+
+	submit(&transfer);
+}
+
+/*
+ * Copy a `width` x `height` rectangle from `source` to `destination`, both
+ * using the same line `offset`. The DMA2D walks the rectangle from its first
+ * pixel onwards, so overlapping areas are fine as long as `destination` is
+ * before `source`, which is what scrolling up needs.
+ */
+void lcd_dma2d_copy(const uint32_t *source, uint32_t *destination, uint32_t width, uint32_t height, uint32_t offset)
+{
+	transfer_t transfer = {
+		.mode = DMA2D_M2M,
+		.input_mode = DMA2D_INPUT_ARGB8888,
+		.source = (uint32_t) source,
+		.destination = (uint32_t) destination,
+		.width = width,
+		.height = height,
+		.offset = offset,
+	};
+
+	submit(&transfer);
+}
+
+/*
+ * Draw `mask`, 4 bits of alpha a pixel with the first pixel in the low
+ * nibble, over a `width` x `height` rectangle of whole lines starting at
+ * `destination`. Every pixel gets `color` and the alpha of the mask.
+ */
+void lcd_dma2d_mask(const uint8_t *mask, uint32_t *destination, uint32_t width, uint32_t height, uint32_t color)
+{
+	transfer_t transfer = {
+		.mode = DMA2D_M2M_PFC,
+		.input_mode = DMA2D_INPUT_A4,
+		.color = color,
+		.source = (uint32_t) mask,
+		.destination = (uint32_t) destination,
+		.width = width,
+		.height = height,
+	};
+
+	submit(&transfer);
+}
@@ -0,0 +1,189 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file qspi.c
+ *
+ *  @brief The N25Q128A QSPI flash of the board, in indirect mode, under the
+ *  log store. Only the commands are sent from here, a few microseconds each:
+ *  the flash then erases or programs on its own while the core goes on, and
+ *  its status register tells when it is done. The upper half of the flash
+ *  holds the log, the lower half is left for code and data.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "main.h"
+#include "n25q128a.h"
+
+#include "qspi.h"
+
+#define QSPI_LOG_ADDRESS	(N25Q128A_FLASH_SIZE / 2)
+#define QSPI_LOG_SIZE		(N25Q128A_FLASH_SIZE / 2)
+
+static QSPI_HandleTypeDef qspi;
+
+static void init_pins(void)
+{
+	GPIO_InitTypeDef gpio = {0};
+
+	__HAL_RCC_GPIOB_CLK_ENABLE();
+	__HAL_RCC_GPIOF_CLK_ENABLE();
+
+	gpio.Mode = GPIO_MODE_AF_PP;
+	gpio.Pull = GPIO_NOPULL;
+	gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+
+	// Chip select.
+	gpio.Pin = GPIO_PIN_6;
+	gpio.Pull = GPIO_PULLUP;
+	gpio.Alternate = GPIO_AF10_QSPI;
+	HAL_GPIO_Init(GPIOB, &gpio);
+
+	// Clock, data 3 and 2.
+	gpio.Pin = GPIO_PIN_10 | GPIO_PIN_6 | GPIO_PIN_7;
+	gpio.Pull = GPIO_NOPULL;
+	gpio.Alternate = GPIO_AF9_QSPI;
+	HAL_GPIO_Init(GPIOF, &gpio);
+
+	// Data 0 and 1.
+	gpio.Pin = GPIO_PIN_8 | GPIO_PIN_9;
+	gpio.Alternate = GPIO_AF10_QSPI;
+	HAL_GPIO_Init(GPIOF, &gpio);
+}
+
+/*
+ * Single line command, with an address and data if `address_mode` and
+ * `data_size` say so.
+ */
+static bool command(uint32_t instruction, uint32_t address_mode, uint32_t address, uint32_t data_size,
+		uint32_t dummy_cycles)
+{
+	QSPI_CommandTypeDef command = {0};
+
+	command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	command.Instruction = instruction;
+	command.AddressMode = address_mode;
+	command.AddressSize = QSPI_ADDRESS_24_BITS;
+	command.Address = address;
+	command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	command.DataMode = data_size ? QSPI_DATA_1_LINE : QSPI_DATA_NONE;
+	command.NbData = data_size;
+	command.DummyCycles = dummy_cycles;
+	command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	return HAL_QSPI_Command(&qspi, &command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) == HAL_OK;
+}
+
+static bool write_enable(void)
+{
+	return command(WRITE_ENABLE_CMD, QSPI_ADDRESS_NONE, 0, 0, 0);
+}
+
+static bool flash_busy(void)
+{
+	uint8_t status = 0;
+
+	if (!command(READ_STATUS_REG_CMD, QSPI_ADDRESS_NONE, 0, 1, 0) ||
+			HAL_QSPI_Receive(&qspi, &status, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+		return false;
+
+	return status & N25Q128A_SR_WIP;
+}
+
+static bool flash_read(uint32_t address, void *data, size_t size)
+{
+	if (!command(FAST_READ_CMD, QSPI_ADDRESS_1_LINE, address, size, N25Q128A_DUMMY_CYCLES_READ))
+		return false;
+
+	return HAL_QSPI_Receive(&qspi, data, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) == HAL_OK;
+}
+
+/*
+ * Start programming `size` bytes within a page, returns without waiting.
+ */
+static bool flash_program(uint32_t address, const void *data, size_t size)
+{
+	if (!write_enable() || !command(PAGE_PROG_CMD, QSPI_ADDRESS_1_LINE, address, size, 0))
+		return false;
+
+	// The HAL does not modify the data, it takes a mutable pointer anyway.
+	return HAL_QSPI_Transmit(&qspi, (uint8_t *) data, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) == HAL_OK;
+}
+
+/*
+ * Start erasing the subsector at `address`, returns without waiting.
+ */
+static bool flash_erase(uint32_t address)
+{
+	return write_enable() && command(SUBSECTOR_ERASE_CMD, QSPI_ADDRESS_1_LINE, address, 0, 0);
+}
+
+static uint32_t flash_time(void)
+{
+	return HAL_GetTick();
+}
+
+const logstore_flash_t qspi_log_flash = {
+	.address = QSPI_LOG_ADDRESS,
+	.size = QSPI_LOG_SIZE,
+	.sector_size = N25Q128A_SUBSECTOR_SIZE,
+	.page_size = N25Q128A_PAGE_SIZE,
+	.read = flash_read,
+	.program = flash_program,
+	.erase = flash_erase,
+	.busy = flash_busy,
+	.time = flash_time,
+};
+
+/*
+ * Start the QSPI and reset the flash, which may have been left in the middle
+ * of an operation by a reset of the core.
+ */
+bool qspi_init(void)
+{
+	__HAL_RCC_QSPI_CLK_ENABLE();
+	__HAL_RCC_QSPI_FORCE_RESET();
+	__HAL_RCC_QSPI_RELEASE_RESET();
+
+	init_pins();
+
+	// Half the AHB clock, 90MHz at full speed.
+	qspi.Instance = QUADSPI;
+	qspi.Init.ClockPrescaler = 1;
+	qspi.Init.FifoThreshold = 4;
+	qspi.Init.SampleShifting = QSPI_SAMPLE_SHIFTING_HALFCYCLE;
+	qspi.Init.FlashSize = POSITION_VAL(N25Q128A_FLASH_SIZE) - 1;
+	qspi.Init.ChipSelectHighTime = QSPI_CS_HIGH_TIME_6_CYCLE;
+	qspi.Init.ClockMode = QSPI_CLOCK_MODE_0;
+	qspi.Init.FlashID = QSPI_FLASH_ID_1;
+	qspi.Init.DualFlash = QSPI_DUALFLASH_DISABLE;
+
+	if (HAL_QSPI_Init(&qspi) != HAL_OK)
+	{
+		printf("QSPI initialisation failed.\n");
+		return false;
+	}
+
+	if (!command(RESET_ENABLE_CMD, QSPI_ADDRESS_NONE, 0, 0, 0) || !command(RESET_MEMORY_CMD, QSPI_ADDRESS_NONE, 0, 0, 0))
+	{
+		printf("QSPI flash reset failed.\n");
+		return false;
+	}
+
+	uint32_t start = HAL_GetTick();
+	while (flash_busy())
+	{
+		if (HAL_GetTick() - start > N25Q128A_SUBSECTOR_ERASE_MAX_TIME)
+		{
+			printf("QSPI flash stuck busy.\n");
+			return false;
+		}
+	}
+
+	return true;
+}
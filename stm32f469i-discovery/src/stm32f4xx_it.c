@@ -1,6 +1,8 @@
 #include "stm32f4xx_it.h"
 #include "stm32469i_discovery.h"
 #include "stm32469i_discovery_audio.h"
+#include "lcd_dma2d.h"
+#include "usb.h"
 
 /* SAI handler declared in "stm32469i_discovery_audio.c" file */
 extern SAI_HandleTypeDef haudio_out_sai;
@@ -8,6 +10,9 @@ extern SAI_HandleTypeDef haudio_out_sai;
 /* I2S handler declared in "stm32469i_discovery_audio.c" file */
 extern I2S_HandleTypeDef haudio_in_i2s;
 
+/* UART handler declared in "uart.c" file */
+extern UART_HandleTypeDef huart3;
+
 void NMI_Handler(void)
 {
 	/* Go to infinite loop when Memory Manage exception occurs */
@@ -85,3 +90,20 @@ void EXTI9_5_IRQHandler(void)
 {
 	HAL_GPIO_EXTI_IRQHandler(TS_INT_PIN);
 }
+
+void USART3_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart3);
+}
+
+void DMA2D_IRQHandler(void)
+{
+	HAL_DMA2D_IRQHandler(&lcd_dma2d_handle);
+}
+
+#if USB_AUDIO
+void OTG_FS_IRQHandler(void)
+{
+	HAL_PCD_IRQHandler(&usb_pcd);
+}
+#endif
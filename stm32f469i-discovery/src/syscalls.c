@@ -56,6 +56,9 @@ extern int __io_getchar(void) __attribute__((weak));
 
 register char * stack_ptr asm("sp");
 
+// Highest break reached by _sbrk(), reported by the telemetry.
+char *sbrk_peak = 0;
+
 char *__env[1] = { 0 };
 char **environ = __env;
 
@@ -110,6 +113,10 @@ int _write(int file, char *data, int len)
       return -1;
    }
 
+   // wait for the frames of the binary telemetry, sent by interrupt
+   uint32_t start = HAL_GetTick();
+   while (huart3.gState != HAL_UART_STATE_READY && HAL_GetTick() - start < 1000);
+
    // arbitrary timeout 1000
    HAL_StatusTypeDef status = HAL_UART_Transmit(&huart3, (uint8_t*)data, len, 1000);
 
@@ -129,13 +136,15 @@ caddr_t _sbrk(int incr)
 	prev_heap_end = heap_end;
 	if (heap_end + incr > stack_ptr)
 	{
-//		write(1, "Heap and stack collision\n", 25);
+		write(1, "Heap and stack collision\n", 25);
 //		abort();
 		errno = ENOMEM;
 		return (caddr_t) -1;
 	}
 
 	heap_end += incr;
+	if (heap_end > sbrk_peak)
+		sbrk_peak = heap_end;
 
 	return (caddr_t) prev_heap_end;
 }
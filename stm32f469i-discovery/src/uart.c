@@ -1,6 +1,9 @@
 #include "main.h"
 #include "stm32f4xx_hal_uart.h"
 
+#include "crc.h"
+#include "uart.h"
+
 UART_HandleTypeDef huart3;
 
 void UART_Init(void)
@@ -19,4 +22,34 @@ void UART_Init(void)
 	{
 		error_handler(__func__, __FILE__, __LINE__);
 	}
+
+	// Below the audio, only used to send the binary telemetry.
+	HAL_NVIC_SetPriority(USART3_IRQn, 0x0F, 0);
+	HAL_NVIC_EnableIRQ(USART3_IRQn);
+}
+
+static bool telemetry_transmit(const uint8_t *data, size_t size)
+{
+	// The HAL does not modify the data, it takes a mutable pointer anyway.
+	return HAL_UART_Transmit_IT(&huart3, (uint8_t *) data, size) == HAL_OK;
+}
+
+static uint32_t telemetry_time(void)
+{
+	return HAL_GetTick();
+}
+
+/*
+ * The frames of the binary telemetry are sent by interrupt, while `printf()`
+ * waits for the line to be idle, see syscalls.c.
+ */
+const telemetry_link_t uart_telemetry_link = {
+	.transmit = telemetry_transmit,
+	.crc = crc_compute,
+	.time = telemetry_time,
+};
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	telemetry_transmitted();
 }
@@ -0,0 +1,143 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file usb.c
+ *
+ *  @brief The USB OTG FS port of the board, CN13, in device mode under the
+ *  USB sound card of usbaudio.c. The callbacks of the HAL are forwarded to
+ *  it and it drives the endpoints through `usb_device`. Its 48MHz comes from
+ *  the PLLQ of the main PLL, set up by `SystemClock_Config()`.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+
+#include "usb.h"
+
+// Words of the 320 of the FIFO RAM: the packets received, those of
+// endpoint 0 and those of the stream.
+#define RX_FIFO_SIZE		0x40
+#define EP0_FIFO_SIZE		(USBAUDIO_EP0_SIZE / 4)
+#define STREAM_FIFO_SIZE	(USBAUDIO_STREAM_EP_SIZE / 4)
+
+// Below the audio interrupts.
+#define USB_IRQ_PRIORITY	7
+
+PCD_HandleTypeDef usb_pcd;
+
+static void init_pins(void)
+{
+	GPIO_InitTypeDef gpio = {0};
+
+	__HAL_RCC_GPIOA_CLK_ENABLE();
+
+	// D- and D+, VBUS is not sensed.
+	gpio.Pin = GPIO_PIN_11 | GPIO_PIN_12;
+	gpio.Mode = GPIO_MODE_AF_PP;
+	gpio.Pull = GPIO_NOPULL;
+	gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	gpio.Alternate = GPIO_AF10_OTG_FS;
+	HAL_GPIO_Init(GPIOA, &gpio);
+}
+
+static void device_open(uint8_t endpoint, uint16_t size, bool isochronous)
+{
+	HAL_PCD_EP_Open(&usb_pcd, endpoint, size, isochronous ? EP_TYPE_ISOC : EP_TYPE_CTRL);
+}
+
+static void device_close(uint8_t endpoint)
+{
+	HAL_PCD_EP_Close(&usb_pcd, endpoint);
+}
+
+static void device_transmit(uint8_t endpoint, const void *data, size_t size)
+{
+	// The HAL does not modify the data, it takes a mutable pointer anyway.
+	HAL_PCD_EP_Transmit(&usb_pcd, endpoint, (uint8_t *) data, size);
+}
+
+static void device_receive(uint8_t endpoint, void *data, size_t size)
+{
+	HAL_PCD_EP_Receive(&usb_pcd, endpoint, data, size);
+}
+
+static void device_stall(uint8_t endpoint)
+{
+	HAL_PCD_EP_SetStall(&usb_pcd, endpoint);
+}
+
+static void device_flush(uint8_t endpoint)
+{
+	HAL_PCD_EP_Flush(&usb_pcd, endpoint);
+}
+
+static void device_set_address(uint8_t address)
+{
+	HAL_PCD_SetAddress(&usb_pcd, address);
+}
+
+const usbaudio_device_t usb_device = {
+	.open = device_open,
+	.close = device_close,
+	.transmit = device_transmit,
+	.receive = device_receive,
+	.stall = device_stall,
+	.flush = device_flush,
+	.set_address = device_set_address,
+};
+
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+{
+	usbaudio_setup((const uint8_t *) hpcd->Setup);
+}
+
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	usbaudio_in_complete(epnum | 0x80);
+}
+
+void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	usbaudio_in_incomplete(epnum | 0x80);
+}
+
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
+{
+	usbaudio_reset();
+}
+
+/*
+ * Start the port. The host sees the sound card as soon as this returns,
+ * `usbaudio_init()` must have been called.
+ */
+bool usb_init(void)
+{
+	init_pins();
+
+	__HAL_RCC_USB_OTG_FS_CLK_ENABLE();
+
+	usb_pcd.Instance = USB_OTG_FS;
+	usb_pcd.Init.dev_endpoints = 4;
+	usb_pcd.Init.speed = PCD_SPEED_FULL;
+	usb_pcd.Init.dma_enable = DISABLE;
+	usb_pcd.Init.phy_itface = PCD_PHY_EMBEDDED;
+	usb_pcd.Init.Sof_enable = DISABLE;
+	usb_pcd.Init.low_power_enable = DISABLE;
+	usb_pcd.Init.lpm_enable = DISABLE;
+	usb_pcd.Init.vbus_sensing_enable = DISABLE;
+	usb_pcd.Init.use_external_vbus = DISABLE;
+
+	if (HAL_PCD_Init(&usb_pcd) != HAL_OK)
+		return false;
+
+	HAL_PCDEx_SetRxFiFo(&usb_pcd, RX_FIFO_SIZE);
+	HAL_PCDEx_SetTxFiFo(&usb_pcd, 0, EP0_FIFO_SIZE);
+	HAL_PCDEx_SetTxFiFo(&usb_pcd, USBAUDIO_STREAM_EP & 0x7F, STREAM_FIFO_SIZE);
+
+	HAL_NVIC_SetPriority(OTG_FS_IRQn, USB_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+
+	return HAL_PCD_Start(&usb_pcd) == HAL_OK;
+}
@@ -0,0 +1,36 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Size of the ring, at the end of the SDRAM so that it stays clear of the
+ * frame buffer. 2MB hold about 12 seconds of 16 bits stereo audio at 44.1kHz.
+ */
+#define CAPTURE_SIZE		(2 * 1024 * 1024)
+
+/*
+ * Number of the most recent audio periods printed when a decode fails, 0 to
+ * never dump the captured audio. Can be overridden from the Makefile.
+ */
+#ifndef CAPTURE_DUMP_PERIODS
+#define CAPTURE_DUMP_PERIODS	0
+#endif
+
+typedef void (*capture_callback_t)(const uint16_t *period);
+
+void capture_init(uint32_t period_length);
+
+void capture_period(const uint16_t *period);
+
+uint32_t capture_count(void);
+
+uint32_t capture_replay(uint32_t first, uint32_t count, capture_callback_t callback);
+
+void capture_copy(void *destination, const void *source, size_t size);
+
+void capture_dump(uint32_t periods);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+
+void console_init(uint16_t height);
+
+void console_reset(uint32_t back_color);
+
+void console_clear(uint32_t back_color);
+
+void console_print(const char *message, uint32_t color);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+bool crc_init(void);
+
+uint32_t crc_compute(const uint32_t *words, size_t count);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef DMA_BUFFER_H
+#define DMA_BUFFER_H
+
+#include <stddef.h>
+
+void dma_buffer_clean(const void *address, size_t size);
+
+void dma_buffer_invalidate(void *address, size_t size);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stdint.h>
+
+#include "chirp_sdk.h"
+
+void governor_init(chirp_sdk_t *sdk);
+
+void governor_state_changed(chirp_sdk_state_t new_state);
+
+void governor_period(uint32_t active_cycles);
+
+#endif
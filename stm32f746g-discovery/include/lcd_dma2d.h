@@ -0,0 +1,20 @@
+#ifndef LCD_DMA2D_H
+#define LCD_DMA2D_H
+
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+void lcd_dma2d_init(void);
+
+void lcd_dma2d_fill(uint32_t *address, uint32_t width, uint32_t height, uint32_t offset, uint32_t color);
+
+void lcd_dma2d_copy(const uint32_t *source, uint32_t *destination, uint32_t width, uint32_t height, uint32_t offset);
+
+void lcd_dma2d_mask(const uint8_t *mask, uint32_t *destination, uint32_t width, uint32_t height, uint32_t color);
+
+void lcd_dma2d_wait(void);
+
+extern DMA2D_HandleTypeDef lcd_dma2d_handle;
+
+#endif
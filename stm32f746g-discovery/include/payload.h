@@ -0,0 +1,36 @@
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chirp_sdk.h"
+
+/*
+ * Size of the send buffer, the longest payload of the embedded protocols.
+ * Payloads are also limited to `chirp_sdk_get_max_payload_length()`.
+ */
+#ifndef PAYLOAD_MAX_LENGTH
+#define PAYLOAD_MAX_LENGTH	32
+#endif
+
+bool payload_init(chirp_sdk_t *sdk);
+
+void payload_set_callbacks(chirp_sdk_callback_set_t callbacks);
+
+chirp_sdk_error_code_t payload_set_config(const char *config);
+
+size_t payload_random(uint8_t *buffer, size_t length);
+
+chirp_sdk_error_code_t payload_send(const uint8_t *data, size_t length);
+
+chirp_sdk_error_code_t payload_send_random(size_t length);
+
+void payload_load_start(uint32_t count);
+
+void payload_print_cache(void);
+
+void payload_process(void);
+
+#endif
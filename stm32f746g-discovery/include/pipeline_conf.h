@@ -0,0 +1,27 @@
+#ifndef PIPELINE_CONF_H
+#define PIPELINE_CONF_H
+
+#include "placement.h"
+
+/*
+ * The conversion loops run every audio period, keep them in ITCM with the
+ * rest of the audio path, and the state of the beamformer in DTCM.
+ */
+#define PIPELINE_TEXT	ITCM_TEXT
+#define PIPELINE_BSS	DTCM_BSS
+
+// 512 frames of interleaved stereo from the codec, 11.6 ms at 44.1 kHz.
+#define PIPELINE_PERIOD_LENGTH	512
+
+// The two digital microphones of the board are recorded as the left and
+// right channels, their beam is decoded.
+#define PIPELINE_BEAMFORMING	1
+
+// Band-pass and gain control ahead of the SDK, a few tens of cycles a sample.
+#define PIPELINE_PREPROCESS		1
+
+// The SDK only runs while the band is louder than the room, the 8 periods
+// of pre-roll, 16K of RAM, hold the 90ms before.
+#define PIPELINE_GATE			1
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/*
+ * Section attributes placing hot code and data in the tightly coupled
+ * memories, see `placement.c` and the linker script. Building with
+ * `make TCM=0` leaves everything in flash and SRAM1 to compare the CPU load.
+ */
+#ifndef USE_TCM
+#define USE_TCM	1
+#endif
+
+/*
+ * Set to 1 by `make XIP=1` to link the cold code, the LCD driver and the
+ * fonts, into the QSPI flash mapped at QSPI_BASE, see the XIP linker script.
+ * The log store is then left out, the flash cannot be read while it programs.
+ */
+#ifndef USE_XIP
+#define USE_XIP	0
+#endif
+
+#if USE_TCM
+#define ITCM_TEXT	__attribute__((section(".itcm_text")))
+#define DTCM_DATA	__attribute__((section(".dtcm_data")))
+#define DTCM_BSS	__attribute__((section(".bss.dtcm")))
+#define DMA_BUFFER	__attribute__((section(".bss.dma_buffer"), aligned(32)))
+#else
+#define ITCM_TEXT
+#define DTCM_DATA
+#define DTCM_BSS
+#define DMA_BUFFER	__attribute__((aligned(32)))
+#endif
+
+void placement_init(void);
+
+void placement_print(void);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef QSPI_H
+#define QSPI_H
+
+#include <stdbool.h>
+
+#include "logstore.h"
+
+bool qspi_init(void);
+
+bool qspi_memory_mapped(void);
+
+extern const logstore_flash_t qspi_log_flash;
+
+#endif
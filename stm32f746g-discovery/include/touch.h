@@ -0,0 +1,12 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
+#include <stdbool.h>
+
+void touch_interrupt(void);
+
+void touch_process(void);
+
+bool touch_pending(void);
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef UART_H
 #define UART_H
 
+#include "telemetry.h"
+
 void UART_Init(void);
 
+extern const telemetry_link_t uart_telemetry_link;
+
 #endif
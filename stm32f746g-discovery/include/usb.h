@@ -0,0 +1,25 @@
+#ifndef USB_H
+#define USB_H
+
+#include <stdbool.h>
+
+#include "stm32f7xx_hal.h"
+#include "usbaudio.h"
+
+/*
+ * Set to 1 by `make USB_AUDIO=1` for the board to show up as a sound card on
+ * the USB OTG FS port, streaming the audio given to the SDK and the audio it
+ * synthesised, see `usbaudio.c`.
+ */
+#ifndef USB_AUDIO
+#define USB_AUDIO	0
+#endif
+
+bool usb_init_clock(void);
+bool usb_init(void);
+
+extern PCD_HandleTypeDef usb_pcd;
+
+extern const usbaudio_device_t usb_device;
+
+#endif
@@ -36,7 +36,18 @@
  * the same folder. For this example it is the `chirp` one.
  */
 #include "chirp_sdk.h"
+#include "arena.h"
+#include "capture.h"
 #include "credentials.h"
+#include "eventlog.h"
+#include "fieldlog.h"
+#include "governor.h"
+#include "payload.h"
+#include "pipeline.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+#include "waveform.h"
 
 /*
  * Main header regrouping any header needed in the project.
@@ -80,16 +91,16 @@ void chirp_error_handler(chirp_sdk_error_code_t errorCode)
  */
 void on_screen_touch(void)
 {
-	// A length of 0 means random length
-	size_t payload_length = 0;
-	uint8_t *payload = chirp_sdk_random_payload(chirp, &payload_length);
-
-	// At this point, the value of `payload_length` has been updated with the new
-	// random length
-	chirp_sdk_error_code_t error = chirp_sdk_send(chirp, payload, payload_length);
-	chirp_sdk_free(payload);
-	if (error != CHIRP_SDK_OK)
+#if LOAD_PAYLOADS
+	// Throughput test, see README.md.
+	payload_load_start(LOAD_PAYLOADS);
+#else
+	// A length of 0 means random length. The payload is drawn from the
+	// hardware RNG into a static buffer, nothing is allocated.
+	chirp_sdk_error_code_t error = payload_send_random(0);
+	if (error != CHIRP_SDK_OK && error != CHIRP_SDK_ALREADY_SENDING)
 		chirp_error_handler(error);
+#endif
 }
 
 /*
@@ -97,8 +108,11 @@ void on_screen_touch(void)
  */
 void on_sending_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
 {
+	eventlog_payload(EVENTLOG_SENDING, payload, length, channel);
+	telemetry_payload(TELEMETRY_SENDING, payload, length, channel);
+
 	// This call erase all previously displayed elements on the screen.
-	set_screen_color(LCD_COLOR_YELLOW);
+	set_screen(&screen_sending);
 }
 
 /*
@@ -106,26 +120,49 @@ void on_sending_callback(void *data, uint8_t *payload, size_t length, uint8_t ch
  */
 void on_sent_callback(void *data, uint8_t *payload, size_t length, uint8_t channel)
 {
+	// The last period of the payload is being synthesised, see waveform.c.
+	waveform_record_end();
+
+	eventlog_payload(EVENTLOG_SENT, payload, length, channel);
+	telemetry_payload(TELEMETRY_SENT, payload, length, channel);
+
 	char hexa_string[length * 2 + 1];
 	payload_to_hex((char *) payload, length, hexa_string);
 	char str_length[16];
 	itoa((int) length, str_length, 10);
-	set_screen_color(LCD_COLOR_WHITE);
+	set_screen(&screen_sent);
 	display_message(hexa_string, LCD_COLOR_BLACK);
 	display_message(str_length, LCD_COLOR_BLACK);
 }
 
+/*
+ * Callback reached when the SDK changes state, used to scale the core clock.
+ */
+void on_state_changed_callback(void *chirp, chirp_sdk_state_t old_state, chirp_sdk_state_t new_state)
+{
+	eventlog_state(old_state, new_state);
+	telemetry_state(old_state, new_state);
+	governor_state_changed(new_state);
+}
+
 void on_receiving_callback(void *chirp, uint8_t *payload, size_t length, uint8_t channel)
 {
-	set_screen_color(LCD_COLOR_BLUE);
-	printf("Receiving data.\n");
+	eventlog_payload(EVENTLOG_RECEIVING, payload, length, channel);
+	telemetry_payload(TELEMETRY_RECEIVING, payload, length, channel);
+	set_screen(&screen_receiving);
 }
 
 void on_received_callback(void *chirp, uint8_t *payload, size_t length, uint8_t channel)
 {
+	eventlog_payload(EVENTLOG_RECEIVED, payload, length, channel);
+	telemetry_payload(TELEMETRY_RECEIVED, payload, length, channel);
+
+	// Kept in the QSPI flash, along with the audio if the decode failed.
+	fieldlog_decode(payload, length);
+
 	if (payload)
 	{
-		set_screen_color(LCD_COLOR_GREEN);
+		set_screen(&screen_received);
 		char hexa_string[length * 2 + 1];
 		payload_to_hex((char *) payload, length, hexa_string);
 		char str_length[16];
@@ -135,8 +172,13 @@ void on_received_callback(void *chirp, uint8_t *payload, size_t length, uint8_t
 	}
 	else
 	{
-		set_screen_color(LCD_COLOR_RED);
+		set_screen(&screen_failed);
 		display_message("Decoding failed.", LCD_COLOR_BLACK);
+
+#if CAPTURE_DUMP_PERIODS
+		// Print the audio which failed to decode, see README.md.
+		capture_dump(CAPTURE_DUMP_PERIODS);
+#endif
 	}
 }
 
@@ -154,7 +196,17 @@ void setup(uint32_t sample_rate)
 		error_handler(__func__, __FILE__, __LINE__);
 	}
 
-	chirp_sdk_error_code_t err = chirp_sdk_set_config(chirp, CHIRP_APP_CONFIG);
+	governor_init(chirp);
+	telemetry_init(chirp, &uart_telemetry_link);
+#if EVENT_LOG
+	eventlog_init(chirp, &timer_clock, sample_rate);
+#endif
+
+	if (!payload_init(chirp))
+		error_handler(__func__, __FILE__, __LINE__);
+
+	// Through the payloads, which cache the audio synthesised with it.
+	chirp_sdk_error_code_t err = payload_set_config(CHIRP_APP_CONFIG);
 	if (err != CHIRP_SDK_OK)
 		chirp_error_handler(err);
 
@@ -167,6 +219,7 @@ void setup(uint32_t sample_rate)
 		chirp_error_handler(err);
 
 	chirp_sdk_callback_set_t callbacks = {0};
+	callbacks.on_state_changed = on_state_changed_callback;
 	callbacks.on_sending = on_sending_callback;
 	callbacks.on_sent = on_sent_callback;
 	callbacks.on_receiving = on_receiving_callback;
@@ -174,6 +227,7 @@ void setup(uint32_t sample_rate)
 	err = chirp_sdk_set_callbacks(chirp, callbacks);
 	if (err != CHIRP_SDK_OK)
 		chirp_error_handler(err);
+	payload_set_callbacks(callbacks);
 
 	err = chirp_sdk_set_callback_ptr(chirp, chirp);
 	if (err != CHIRP_SDK_OK)
@@ -185,11 +239,34 @@ void setup(uint32_t sample_rate)
 	if (err != CHIRP_SDK_OK)
 		chirp_error_handler(err);
 
+	// Band-pass the recorded audio to the band of the protocol before it
+	// reaches the SDK, see pipeline.h.
+	char *info = chirp_sdk_get_info(chirp);
+	if (!pipeline_set_band_from_info(info, sample_rate))
+		printf("No band known for \"%s\", the input is only levelled.\n", info);
+	chirp_sdk_free(info);
+
 	err = chirp_sdk_start(chirp);
 	if (err != CHIRP_SDK_OK)
 		chirp_error_handler(err);
 
 	printf("Chirp SDK initialised.\n");
+
+	// The SDK keeps its own count of what it allocated, the arena also
+	// accounts for the block headers and what the C library allocated.
+	arena_stats_t stats;
+	arena_get_stats(&stats);
+	printf("Heap: %ld bytes used by the SDK, %u bytes peak of %u in the arena.\n",
+			chirp_sdk_get_heap_usage(chirp), stats.peak, stats.size);
+}
+
+/*
+ * Whether the pipeline can keep silent audio from the SDK, only while it is
+ * waiting for a chirp. It must keep sending and finish receiving.
+ */
+bool can_skip(void)
+{
+	return chirp_sdk_get_state(chirp) == CHIRP_SDK_STATE_RUNNING;
 }
 
 /*
@@ -0,0 +1,238 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file capture.c
+ *
+ *  @brief History of the recorded audio kept in the external SDRAM. Every
+ *  period recorded in the internal buffer is copied by the DMA into a ring
+ *  holding the last seconds of audio, without using the CPU nor internal RAM.
+ *
+ *  Periods the main loop did not process in time, for instance while the
+ *  screen was being redrawn, can then be replayed into the decoder from the
+ *  ring. A second DMA stream prefetches the next period into an internal
+ *  staging buffer while the current one is decoded. The ring can also be
+ *  printed on the serial line to analyse a failed decode.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+#include "stm32746g_discovery_sdram.h"
+
+#include "capture.h"
+#include "dma_buffer.h"
+#include "placement.h"
+
+#define CAPTURE_ADDRESS		(SDRAM_DEVICE_ADDR + SDRAM_DEVICE_SIZE - CAPTURE_SIZE)
+
+// Largest audio period, in samples, the staging buffers can hold.
+#define CAPTURE_MAX_PERIOD_LENGTH	1024
+
+// A period is copied in a few microseconds, this only guards against a stuck DMA.
+#define CAPTURE_DMA_TIMEOUT	10
+
+/*
+ * Memory to memory transfers are only possible on DMA2. The SAI uses its
+ * streams 4 and 7.
+ */
+#define CAPTURE_WRITE_STREAM	DMA2_Stream0
+#define CAPTURE_READ_STREAM		DMA2_Stream1
+#define CAPTURE_COPY_STREAM		DMA2_Stream2
+
+static DMA_HandleTypeDef write_dma;
+static DMA_HandleTypeDef read_dma;
+static DMA_HandleTypeDef copy_dma;
+
+static uint16_t *ring = (uint16_t *) CAPTURE_ADDRESS;
+static uint32_t period_length = 0;
+static uint32_t ring_periods = 0;
+
+// Number of periods captured since the start, the next one goes in slot
+// `captured % ring_periods`.
+static volatile uint32_t captured = 0;
+
+// Set while the ring is printed so that it is not overwritten meanwhile.
+static volatile bool frozen = false;
+
+DMA_BUFFER static uint16_t staging[2][CAPTURE_MAX_PERIOD_LENGTH];
+
+static void init_dma(DMA_HandleTypeDef *dma, DMA_Stream_TypeDef *stream)
+{
+	dma->Instance = stream;
+	dma->Init.Channel = DMA_CHANNEL_0;
+	dma->Init.Direction = DMA_MEMORY_TO_MEMORY;
+	dma->Init.PeriphInc = DMA_PINC_ENABLE;
+	dma->Init.MemInc = DMA_MINC_ENABLE;
+	dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+	dma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+	dma->Init.Mode = DMA_NORMAL;
+	dma->Init.Priority = DMA_PRIORITY_LOW;
+	dma->Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+	dma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	dma->Init.MemBurst = DMA_MBURST_SINGLE;
+	dma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+
+	if (HAL_DMA_Init(dma) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+}
+
+/*
+ * Block until the transfer in flight on `dma`, if any, is done.
+ */
+static void wait_dma(DMA_HandleTypeDef *dma)
+{
+	if (dma->State == HAL_DMA_STATE_BUSY)
+	{
+		if (HAL_DMA_PollForTransfer(dma, HAL_DMA_FULL_TRANSFER, CAPTURE_DMA_TIMEOUT) != HAL_OK)
+			error_handler(__func__, __FILE__, __LINE__);
+	}
+}
+
+static uint16_t *slot(uint32_t index)
+{
+	return ring + (index % ring_periods) * period_length;
+}
+
+/*
+ * Whether the period `index` is in the ring and not being written. A margin
+ * of one slot is kept for the copy the next interrupt may start.
+ */
+static bool available(uint32_t index)
+{
+	uint32_t count = captured;
+
+	return index + 1 < count && count - index < ring_periods - 1;
+}
+
+/*
+ * Must be called once the SDRAM has been initialised, which the LCD does.
+ * `length` is the number of samples of an audio period.
+ */
+void capture_init(uint32_t length)
+{
+	if (length > CAPTURE_MAX_PERIOD_LENGTH)
+		error_handler(__func__, __FILE__, __LINE__);
+
+	period_length = length;
+	ring_periods = CAPTURE_SIZE / (length * sizeof(uint16_t));
+
+	__HAL_RCC_DMA2_CLK_ENABLE();
+	init_dma(&write_dma, CAPTURE_WRITE_STREAM);
+	init_dma(&read_dma, CAPTURE_READ_STREAM);
+	init_dma(&copy_dma, CAPTURE_COPY_STREAM);
+}
+
+/*
+ * Copy `size` bytes between the internal RAM and the rest of the SDRAM, on a
+ * stream of its own, for the other users of the SDRAM such as the waveform
+ * cache. The copy runs in the background, the next one waits for it.
+ */
+void capture_copy(void *destination, const void *source, size_t size)
+{
+	wait_dma(&copy_dma);
+
+	if (HAL_DMA_Start(&copy_dma, (uint32_t) source, (uint32_t) destination, size / sizeof(uint16_t)) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+}
+
+/*
+ * Called from the audio interrupt once a period has been recorded at
+ * `period`. The copy runs in the background, the period must be left
+ * untouched until the next one is recorded.
+ */
+void capture_period(const uint16_t *period)
+{
+	if (ring_periods == 0 || frozen)
+		return;
+
+	wait_dma(&write_dma);
+
+	dma_buffer_clean(period, period_length * sizeof(uint16_t));
+
+	if (HAL_DMA_Start(&write_dma, (uint32_t) period, (uint32_t) slot(captured), period_length) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+
+	captured++;
+}
+
+/*
+ * Number of periods recorded since the start. The last one is still in the
+ * internal buffer, the ones before can be replayed from the ring.
+ */
+uint32_t capture_count(void)
+{
+	return captured;
+}
+
+/*
+ * Call `callback` with each of the `count` periods starting at `first`,
+ * oldest first, each one copied back in internal RAM. Stops at the first
+ * period no longer in the ring and returns the number of periods replayed.
+ */
+uint32_t capture_replay(uint32_t first, uint32_t count, capture_callback_t callback)
+{
+	uint32_t replayed = 0;
+
+	if (count == 0 || !available(first))
+		return 0;
+
+	if (HAL_DMA_Start(&read_dma, (uint32_t) slot(first), (uint32_t) staging[0], period_length) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+
+	while (replayed < count)
+	{
+		uint16_t *current = staging[replayed % 2];
+		wait_dma(&read_dma);
+
+		// Prefetch the next period while this one is decoded.
+		uint32_t next = first + replayed + 1;
+		bool prefetch = replayed + 1 < count && available(next);
+		if (prefetch)
+		{
+			if (HAL_DMA_Start(&read_dma, (uint32_t) slot(next), (uint32_t) staging[(replayed + 1) % 2], period_length) != HAL_OK)
+				error_handler(__func__, __FILE__, __LINE__);
+		}
+
+		dma_buffer_invalidate(current, period_length * sizeof(uint16_t));
+		callback(current);
+		replayed++;
+
+		if (!prefetch)
+			break;
+	}
+
+	return replayed;
+}
+
+/*
+ * Print the last `periods` periods on the serial line as CSV, one period per
+ * line, with the samples of the left channel in hexadecimal. Capturing stops
+ * meanwhile, which takes a while at 115200 bauds, so the audio recorded in
+ * the mean time is lost.
+ */
+void capture_dump(uint32_t periods)
+{
+	frozen = true;
+	wait_dma(&write_dma);
+
+	uint32_t count = captured;
+	if (periods > count)
+		periods = count;
+	if (periods > ring_periods)
+		periods = ring_periods;
+
+	printf("capture,period,samples\n");
+
+	for (uint32_t index = count - periods; index < count; index++)
+	{
+		const uint16_t *samples = slot(index);
+
+		printf("capture,%lu,", index);
+		for (uint32_t i = 0; i < period_length; i += 2)
+			printf("%04x", samples[i]);
+		printf("\n");
+	}
+
+	frozen = false;
+}
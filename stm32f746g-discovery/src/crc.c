@@ -0,0 +1,42 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file crc.c
+ *
+ *  @brief The CRC unit of the core, set up as the fixed one of the STM32F4:
+ *  polynomial 0x04C11DB7, initial value 0xFFFFFFFF, 32 bits words and no
+ *  reflection, so that the frames of telemetry.c are checked the same way
+ *  on both boards.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+
+#include "crc.h"
+
+static CRC_HandleTypeDef crc;
+
+bool crc_init(void)
+{
+	__HAL_RCC_CRC_CLK_ENABLE();
+
+	crc.Instance = CRC;
+	crc.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_ENABLE;
+	crc.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_ENABLE;
+	crc.Init.InputDataInversionMode = CRC_INPUTDATA_INVERSION_NONE;
+	crc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+	crc.InputDataFormat = CRC_INPUTDATA_FORMAT_WORDS;
+
+	return HAL_CRC_Init(&crc) == HAL_OK;
+}
+
+/*
+ * CRC-32 of `count` words, started over at every call.
+ */
+uint32_t crc_compute(const uint32_t *words, size_t count)
+{
+	// The HAL only reads the words, it takes a mutable pointer anyway.
+	return HAL_CRC_Calculate(&crc, (uint32_t *) words, count);
+}
@@ -0,0 +1,84 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file dma_buffer.c
+ *
+ *  @brief Keep the D-cache and the buffers accessed by the DMA coherent.
+ *  Buffers declared with `DMA_BUFFER` are aligned on cache lines and, unless
+ *  the example is built with `TCM=0`, placed in SRAM2 which the MPU makes
+ *  non cacheable, in which case there is nothing to do. Otherwise, a buffer
+ *  written by the CPU must be cleaned before the DMA reads it, and a buffer
+ *  written by the DMA must be invalidated before the CPU reads it.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+
+#include "main.h"
+#include "dma_buffer.h"
+
+// Size of the SRAM2 region made non cacheable in `placement_init()`.
+#define DMA_BUFFER_POOL_SIZE	(16 * 1024)
+
+// Cache maintenance works on whole lines.
+#define DMA_BUFFER_LINE_SIZE	32
+
+/*
+ * Whether the `size` bytes at `address` are in the non cacheable pool.
+ */
+static bool is_uncached(const void *address, size_t size)
+{
+	uint32_t start = (uint32_t) address;
+
+	return start >= SRAM2_BASE && start + size <= SRAM2_BASE + DMA_BUFFER_POOL_SIZE;
+}
+
+/*
+ * Round the area down and up to whole cache lines. The buffer must have been
+ * declared with `DMA_BUFFER` so that no other data shares these lines.
+ */
+static void align_to_lines(const void *address, size_t size, uint32_t **start, int32_t *length)
+{
+	uint32_t first = (uint32_t) address & ~(DMA_BUFFER_LINE_SIZE - 1);
+	uint32_t end = ((uint32_t) address + size + DMA_BUFFER_LINE_SIZE - 1) & ~(DMA_BUFFER_LINE_SIZE - 1);
+
+	*start = (uint32_t *) first;
+	*length = end - first;
+}
+
+/*
+ * Write back to memory the `size` bytes at `address` written by the CPU, so
+ * the DMA reads up to date data. To be called before starting a transfer
+ * from this area or, for circular transfers, once the CPU has filled the part
+ * the DMA reads next.
+ */
+void dma_buffer_clean(const void *address, size_t size)
+{
+	if (size == 0 || is_uncached(address, size))
+		return;
+
+	uint32_t *start;
+	int32_t length;
+	align_to_lines(address, size, &start, &length);
+
+	SCB_CleanDCache_by_Addr(start, length);
+}
+
+/*
+ * Discard the cached copy of the `size` bytes at `address` written by the
+ * DMA, so the CPU reads them from memory. To be called once a transfer into
+ * this area is done and before the CPU reads it.
+ */
+void dma_buffer_invalidate(void *address, size_t size)
+{
+	if (size == 0 || is_uncached(address, size))
+		return;
+
+	uint32_t *start;
+	int32_t length;
+	align_to_lines(address, size, &start, &length);
+
+	SCB_InvalidateDCache_by_Addr(start, length);
+}
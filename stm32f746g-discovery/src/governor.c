@@ -0,0 +1,158 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file governor.c
+ *
+ *  @brief Scale the core clock with the state of the SDK. The core runs at
+ *  full speed while sending or receiving and at half speed while the SDK is
+ *  only listening for a chirp, provided the recent peak listening load
+ *  leaves enough headroom at half speed.
+ *
+ *  Only the AHB prescaler is changed. The main PLL, and with it the overdrive
+ *  and flash latency, is left alone because its input divider is shared with
+ *  the PLLs clocking the audio interface and the LCD, which therefore keep
+ *  running untouched. The APB prescalers are changed the opposite way so
+ *  that the peripheral clocks, and the UART baud rate with them, do not move.
+ *  The SDRAM clock follows HCLK, so its refresh rate is reprogrammed.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+#include "stm32746g_discovery_sdram.h"
+#include "governor.h"
+#include "idle.h"
+#include "telemetry.h"
+
+/*
+ * Number of audio periods the SDK must have been listening for before the
+ * clock is lowered, which also gives time to measure the listening load.
+ */
+#define GOVERNOR_IDLE_PERIODS	100
+
+/*
+ * Largest share of a half speed period the listening load may use, in
+ * percent. The margin covers the interrupts and the screen updates which do
+ * not happen every period.
+ */
+#define GOVERNOR_HEADROOM	70
+
+/*
+ * SDRAM refresh count for the SDRAM clock at half speed. The BSP value is
+ * the number of SDRAM clock cycles between two refreshes minus a 20 cycles
+ * safety margin.
+ */
+#define GOVERNOR_REFRESH_COUNT	((REFRESH_COUNT + 20) / 2 - 20)
+
+/*
+ * Every period spent in a state, its peak loses 1/2^GOVERNOR_PEAK_DECAY of
+ * itself, halving in about 180 periods, so that a one-off spike such as the
+ * first periods of the SDK or a screen redraw does not hold the clock up
+ * for good.
+ */
+#define GOVERNOR_PEAK_DECAY	8
+
+// Number of values of `chirp_sdk_state_t`.
+#define GOVERNOR_STATES	(CHIRP_SDK_STATE_RECEIVING + 1)
+
+static chirp_sdk_t *governor_sdk = NULL;
+
+static bool low_speed = false;
+
+// Audio periods spent in the current state.
+static uint32_t state_periods = 0;
+
+// Highest number of active cycles per audio period lately, for each state.
+static uint32_t state_peak[GOVERNOR_STATES] = {0};
+
+/*
+ * Switch HCLK between SYSCLK and half of it.
+ */
+static void set_low_speed(bool enable)
+{
+	RCC_ClkInitTypeDef clock = {0};
+
+	clock.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+	clock.AHBCLKDivider = enable ? RCC_SYSCLK_DIV2 : RCC_SYSCLK_DIV1;
+	clock.APB1CLKDivider = enable ? RCC_HCLK_DIV2 : RCC_HCLK_DIV4;
+	clock.APB2CLKDivider = enable ? RCC_HCLK_DIV1 : RCC_HCLK_DIV2;
+
+	// The shorter refresh count is in place whenever the clock changes, so
+	// the SDRAM is refreshed too often rather than not enough.
+	if (enable)
+		FMC_SDRAM_ProgramRefreshRate(FMC_SDRAM_DEVICE, GOVERNOR_REFRESH_COUNT);
+
+	// This also updates `SystemCoreClock` and reconfigures the SysTick.
+	if (HAL_RCC_ClockConfig(&clock, FLASH_LATENCY_5) != HAL_OK)
+		error_handler(__func__, __FILE__, __LINE__);
+
+	if (!enable)
+		FMC_SDRAM_ProgramRefreshRate(FMC_SDRAM_DEVICE, REFRESH_COUNT);
+
+	low_speed = enable;
+
+	telemetry_clock(SystemCoreClock,
+			state_peak[CHIRP_SDK_STATE_RUNNING],
+			state_peak[CHIRP_SDK_STATE_SENDING],
+			state_peak[CHIRP_SDK_STATE_RECEIVING]);
+}
+
+/*
+ * Whether the listening load measured so far fits in a half speed period.
+ */
+static bool low_speed_fits(void)
+{
+	uint32_t cycles = idle_period_cycles();
+	if (!low_speed)
+		cycles /= 2;
+
+	return state_peak[CHIRP_SDK_STATE_RUNNING] <= (uint64_t) cycles * GOVERNOR_HEADROOM / 100;
+}
+
+/*
+ * Must be called once the SDK has been created, before it is started.
+ */
+void governor_init(chirp_sdk_t *sdk)
+{
+	governor_sdk = sdk;
+}
+
+/*
+ * To be called from the `on_state_changed` callback. Sending and receiving
+ * need the full speed straight away, lowering it is left to
+ * `governor_period()` once the SDK has been listening for a while.
+ */
+void governor_state_changed(chirp_sdk_state_t new_state)
+{
+	state_periods = 0;
+
+	if (new_state != CHIRP_SDK_STATE_RUNNING && low_speed)
+		set_low_speed(false);
+}
+
+/*
+ * Called once an audio period has been processed with the number of cycles
+ * it took.
+ */
+void governor_period(uint32_t active_cycles)
+{
+	if (governor_sdk == NULL)
+		return;
+
+	chirp_sdk_state_t state = chirp_sdk_get_state(governor_sdk);
+	if (state >= GOVERNOR_STATES)
+		return;
+
+	state_peak[state] -= state_peak[state] >> GOVERNOR_PEAK_DECAY;
+	if (active_cycles > state_peak[state])
+		state_peak[state] = active_cycles;
+	state_periods++;
+
+	bool listening = state == CHIRP_SDK_STATE_RUNNING && state_periods >= GOVERNOR_IDLE_PERIODS;
+
+	if (low_speed && !(listening && low_speed_fits()))
+		set_low_speed(false);
+	else if (!low_speed && listening && low_speed_fits())
+		set_low_speed(true);
+}
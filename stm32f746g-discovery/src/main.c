@@ -21,9 +21,28 @@
 #include "stm32746g_discovery.h"
 #include "stm32746g_discovery_audio.h"
 #include "stm32746g_discovery_lcd.h"
+#include "stm32746g_discovery_sdram.h"
 #include "stm32746g_discovery_ts.h"
 
+#include "capture.h"
+#include "console.h"
+#include "crc.h"
+#include "dma_buffer.h"
+#include "eventlog.h"
+#include "fieldlog.h"
+#include "governor.h"
+#include "idle.h"
+#include "lcd_dma2d.h"
+#include "payload.h"
+#include "pipeline.h"
+#include "placement.h"
+#include "qspi.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "touch.h"
 #include "uart.h"
+#include "usb.h"
+#include "waveform.h"
 
 /*
  * Forward declarations of functions located either in application.c or at the
@@ -33,47 +52,38 @@ void CPU_CACHE_Enable(void);
 void SystemClock_Config(void);
 void setup(uint32_t sample_rate);
 void loop(float *buffer, uint16_t blocksize);
+bool can_skip(void);
 
 #define VOLUME 				100
 #define SAMPLE_RATE 	  	44100
-#define SHORT_BUFFER_SIZE 	2048
-#define FLOAT_BUFFER_SIZE 	(SHORT_BUFFER_SIZE / 4)
+// Two periods of the pipeline, see pipeline_conf.h.
+#define SHORT_BUFFER_SIZE 	PIPELINE_BUFFER_LENGTH
+#define FLOAT_BUFFER_SIZE 	PIPELINE_FLOAT_LENGTH
 
-/*
- * Used to keep track of the state of buffers.
- */
-typedef enum {
-	BUFFER_STATE_EMPTY,
-	BUFFER_STATE_HALF,
-	BUFFER_STATE_FULL,
-} BUFFER_STATE;
-
-/**
- * Allows to know if we are playing or listening.
- */
-typedef enum {
-	NONE,
-	PLAYING,
-	LISTENING,
-} AUDIO_STATE;
-
-AUDIO_STATE audio_state = NONE;
+// Audio of the payloads sent, see waveform.c.
+#define WAVEFORM_SIZE			(2 * 1024 * 1024)
+#define WAVEFORM_ADDRESS		(SDRAM_DEVICE_ADDR + SDRAM_DEVICE_SIZE - CAPTURE_SIZE - WAVEFORM_SIZE)
 
 /*
- * Buffers containing the audio to play or record.
+ * Buffers containing the audio to play or record. They are read and written
+ * by the DMA so they live in the non cacheable SRAM2, while the float buffer
+ * only used by the CPU lives in DTCM. The cache maintenance done by the
+ * pipeline only matters when they are moved to cacheable memory.
  */
-uint16_t short_record_buffer[SHORT_BUFFER_SIZE] = {0};
-BUFFER_STATE record_buffer_state = BUFFER_STATE_EMPTY;
-uint32_t record_buffer_offset = 0;
+DMA_BUFFER uint16_t short_record_buffer[SHORT_BUFFER_SIZE];
+DMA_BUFFER uint16_t short_play_buffer[SHORT_BUFFER_SIZE];
+DTCM_BSS float float_buffer[FLOAT_BUFFER_SIZE];
 
-uint16_t short_play_buffer[SHORT_BUFFER_SIZE] = {0};
-BUFFER_STATE play_buffer_state = BUFFER_STATE_EMPTY;
-uint32_t play_buffer_offset = 0;
+#if USB_AUDIO
+// Copy of the period given to the SDK, streamed along with what it played.
+DTCM_BSS static float streamed_buffer[FLOAT_BUFFER_SIZE];
+#endif
 
-float float_buffer[FLOAT_BUFFER_SIZE] = {0};
+// Set by the user button interrupt and handled in the main loop.
+volatile bool button_pressed = false;
 
-// Used to debounce button and screen.
-uint32_t tick_saved = 0;
+// Used to debounce the button.
+uint32_t button_tick_saved = 0;
 
 /*
  * Simple handler printing on the serial line where the error occurred.
@@ -85,85 +95,76 @@ void error_handler(const char *function, char *file, int line)
 }
 
 /*
- * This function is called when the user press the user button (blue one). The
- * debouncing prevents from pressing the button more than once per second.
+ * This function is called from the main loop when the user pressed the user
+ * button (blue one). The debouncing prevents from pressing the button more
+ * than once per second.
  */
 void button_user_event(void)
 {
 	uint32_t tick_time = HAL_GetTick();
 
 	// Here, 1000 = 1000 ms = 1s
-	if (tick_time - tick_saved > 1000)
+	if (tick_time - button_tick_saved > 1000)
 	{
-		if (audio_state == PLAYING)
+		if (pipeline_get_mode() == PIPELINE_PLAYING)
 		{
-			audio_state = LISTENING;
+			pipeline_set_mode(PIPELINE_LISTENING);
 			display_message("Listening.", LCD_COLOR_BLACK);
 		}
-		else if (audio_state == LISTENING)
+		else if (pipeline_get_mode() == PIPELINE_LISTENING)
 		{
-			audio_state = PLAYING;
+			pipeline_set_mode(PIPELINE_PLAYING);
 			display_message("Playing.", LCD_COLOR_BLACK);
 		}
 
-		tick_saved = tick_time;
+		button_tick_saved = tick_time;
 	}
 }
 
 /*
  * Whenever an interruption is received for the touch screen or the user button,
- * this function is reached.
+ * this function is reached. The events are only recorded here and handled in
+ * the main loop, so that neither the LCD nor the SDK are used from an
+ * interrupt.
  */
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
 	if (GPIO_Pin == TS_INT_PIN)
 	{
-		uint32_t tick_time = HAL_GetTick();
-
-		if (tick_time - tick_saved > 1000)
-		{
-			on_screen_touch();
-			tick_saved = tick_time;
-		}
+		touch_interrupt();
 	}
 	else if (GPIO_Pin == KEY_BUTTON_PIN)
 	{
-		button_user_event();
+		button_pressed = true;
 	}
 }
 
 /*
- * Set the totality of the screen to the specified color.
+ * Set the totality of the screen to the specified color. This also clears the
+ * console, the next message will be displayed at the top of the screen.
  */
 void set_screen_color(uint32_t color)
 {
-	uint32_t heigh = BSP_LCD_GetYSize();
-	uint32_t width = BSP_LCD_GetXSize();
-	uint32_t save_background_color = BSP_LCD_GetTextColor();
-	BSP_LCD_SetTextColor(color);
-	BSP_LCD_FillRect(0, 0, width, heigh);
-	BSP_LCD_SetTextColor(save_background_color);
+	console_clear(color);
 }
 
 /*
- * Display a message. The line to display is automatically incremented and goes
- * back to the beginning of the screen when reaching the end.
+ * Display one of the pre-rendered screens. As for `set_screen_color()`, the
+ * console is cleared.
  */
-void display_message(char *message, uint32_t color)
+void set_screen(const screen_t *screen)
 {
-	static uint8_t line_count = 0;
-
-	uint8_t chars_per_line = BSP_LCD_GetXSize() / BSP_LCD_GetFont()->Width;
-	size_t message_length = strlen(message);
+	screen_show(screen);
+	console_reset(screen->background);
+}
 
-	uint8_t lines_needed = message_length / chars_per_line + 1;
-	for (uint8_t l = 0; l < lines_needed; l ++)
-	{
-		BSP_LCD_DisplayStringAtLine(line_count, (uint8_t *)(message + l * chars_per_line));
-		line_count++;
-		if (line_count > BSP_LCD_GetYSize() / BSP_LCD_GetFont()->Height)
-			line_count = 0;
-	}
+/*
+ * Display a message on the console. Long messages are wrapped and the console
+ * scrolls up once the bottom of the screen is reached.
+ */
+void display_message(char *message, uint32_t color)
+{
+	console_print(message, color);
 }
 
 /*
@@ -180,7 +181,18 @@ void LCD_Init(void)
 	BSP_LCD_SetFont(&Font12);
 	BSP_LCD_SetBackColor(LCD_COLOR_WHITE);
 	BSP_LCD_SetTextColor(LCD_COLOR_BLACK);
-	BSP_LCD_Clear(LCD_COLOR_WHITE);
+
+	lcd_dma2d_init();
+
+	// The banner of the screens stays below the console.
+	console_init(screen_listening.height - screen_listening.banner_height);
+	set_screen(&screen_listening);
+
+	// The SDRAM holding the capture ring is initialised with the LCD.
+	capture_init(SHORT_BUFFER_SIZE / 2);
+
+	// The payloads sent are cached by the period, just below the ring.
+	waveform_init((void *) WAVEFORM_ADDRESS, WAVEFORM_SIZE, SHORT_BUFFER_SIZE / 2 * sizeof(uint16_t), capture_copy);
 }
 
 /*
@@ -189,14 +201,12 @@ void LCD_Init(void)
 
 void BSP_AUDIO_IN_HalfTransfer_CallBack(void)
 {
-	record_buffer_offset = 0;
-	record_buffer_state = BUFFER_STATE_HALF;
+	pipeline_recorded(0);
 }
 
 void BSP_AUDIO_IN_TransferComplete_CallBack(void)
 {
-	record_buffer_offset = SHORT_BUFFER_SIZE / 2;
-	record_buffer_state = BUFFER_STATE_FULL;
+	pipeline_recorded(1);
 }
 
 void BSP_AUDIO_IN_Error_CallBack(void)
@@ -206,14 +216,12 @@ void BSP_AUDIO_IN_Error_CallBack(void)
 
 void BSP_AUDIO_OUT_HalfTransfer_CallBack(void)
 {
-	play_buffer_offset = 0;
-	play_buffer_state = BUFFER_STATE_HALF;
+	pipeline_played(0);
 }
 
 void BSP_AUDIO_OUT_TransferComplete_CallBack(void)
 {
-	play_buffer_offset = SHORT_BUFFER_SIZE / 2;
-	play_buffer_state = BUFFER_STATE_FULL;
+	pipeline_played(1);
 }
 
 void BSP_AUDIO_OUT_Error_CallBack(void)
@@ -221,6 +229,32 @@ void BSP_AUDIO_OUT_Error_CallBack(void)
 	printf("Audio OUT error callback reached.\n");
 }
 
+/*
+ * Called by the pipeline after every audio period.
+ */
+void period_processed(void)
+{
+	governor_period(idle_period());
+	telemetry_period();
+	eventlog_process();
+}
+
+/*
+ * Board side of the audio pipeline: the recorded audio is kept in the
+ * capture ring, the audio played in the waveform cache, and the DMA buffers
+ * need cache maintenance.
+ */
+const pipeline_hal_t pipeline_hal = {
+	.recorded = capture_period,
+	.recorded_count = capture_count,
+	.replay = capture_replay,
+	.invalidate = dma_buffer_invalidate,
+	.clean = dma_buffer_clean,
+	.processed = period_processed,
+	.fill = waveform_fill,
+	.played = waveform_played,
+};
+
 /*
  * Initialise the audio and set the audio state as listening.
  */
@@ -246,73 +280,45 @@ bool init_audio(void)
 		printf("Playing failed\n");
 	}
 
-	audio_state = LISTENING;
+	pipeline_set_mode(PIPELINE_LISTENING);
 
 	return true;
 }
 
-
-float uint16_to_float(uint16_t sample)
-{
-	int16_t val = (int16_t) sample;
-	float f = (float) val / 32768.0f;
-	if ( f > 1 ) f = 1;
-	if ( f < -1 ) f = -1;
-	return f;
-}
-
-uint16_t float_to_uint16(float sample)
+/*
+ * Sleep until the next interrupt if nothing is left to process. Interrupts
+ * are masked during the check so that an event arriving between the check and
+ * the sleep still wakes the core up.
+ */
+void wait_for_event(void)
 {
-	// Move or float sample between 1 and 3.
-	float f = sample + 2.0f;
+	__disable_irq();
 
-	// Convert the previous value to an unsigned short between 32767 and 98302.
-	uint16_t val = f * 32767.0f;
+	if (!pipeline_pending() && !touch_pending() && !button_pressed)
+		idle_wait();
 
-	return val;
+	__enable_irq();
 }
 
+#if USB_AUDIO
 /*
- * This function is called in the main while loop.
- * Whenever some samples are ready to be played or analysed, a float buffer
- * is sent to the application `loop` function.
+ * Process a period with `loop()` and stream both the audio it was given and
+ * the audio it left in the buffer to the host, when the host listens. The
+ * ring of usbaudio.c takes the frames without ever waiting.
  */
-void process_audio(void)
+static void loop_streamed(float *buffer, uint16_t blocksize)
 {
-	if (audio_state == LISTENING)
+	if (!usbaudio_streaming())
 	{
-		if (record_buffer_state != BUFFER_STATE_EMPTY)
-		{
-			// Convert half of the stereo short buffer into a float one
-			for (size_t i = 0; i < FLOAT_BUFFER_SIZE; i++)
-			{
-				float_buffer[i] = uint16_to_float(short_record_buffer[record_buffer_offset + i * 2]);
-			}
-
-			loop(&float_buffer[0], FLOAT_BUFFER_SIZE);
-
-			record_buffer_state = BUFFER_STATE_EMPTY;
-		}
+		loop(buffer, blocksize);
+		return;
 	}
-	else if (audio_state == PLAYING)
-	{
-		if (play_buffer_state != BUFFER_STATE_EMPTY)
-		{
-			loop(&float_buffer[0], FLOAT_BUFFER_SIZE);
-
-			// Convert a mono float buffer into half of a stereo short one.
-			for (size_t i = 0; i < FLOAT_BUFFER_SIZE; i++)
-			{
-				uint16_t value = float_to_uint16(float_buffer[i]);
-				short_play_buffer[play_buffer_offset + i * 2] = value;
-				short_play_buffer[play_buffer_offset + i * 2 + 1] = value;
 
-			}
-
-			play_buffer_state = BUFFER_STATE_EMPTY;
-		}
-	}
+	memcpy(streamed_buffer, buffer, blocksize * sizeof(float));
+	loop(buffer, blocksize);
+	usbaudio_write(streamed_buffer, buffer, blocksize);
 }
+#endif
 
 /*
  * Main of the program. It initialises the board peripherals and loop
@@ -320,15 +326,40 @@ void process_audio(void)
  */
 int main(void)
 {
+	placement_init();
 	CPU_CACHE_Enable();
 	HAL_Init();
 	SystemClock_Config();
 
 	UART_Init();
 
+#if BINARY_TELEMETRY
+	// Checks the frames of the telemetry.
+	if (!crc_init())
+		error_handler(__func__, __FILE__, __LINE__);
+#endif
+
+#if EVENT_LOG
+	// Stamps the events of the SDK.
+	if (!timer_init())
+		error_handler(__func__, __FILE__, __LINE__);
+#endif
+
 	// Allow to offer a pretty rendering between every starts.
 	printf("\n\n");
 
+#if USE_XIP
+	// Nothing linked into the QSPI flash may run before this.
+	if (!qspi_init() || !qspi_memory_mapped())
+		error_handler(__func__, __FILE__, __LINE__);
+#endif
+
+#if USB_AUDIO
+	// The PLLSAI runs the LTDC once the LCD starts, it must not restart after.
+	if (!usb_init_clock())
+		printf("USB clock configuration failed.\n");
+#endif
+
 	LCD_Init();
 
 	BSP_PB_Init(BUTTON_KEY, BUTTON_MODE_EXTI);
@@ -340,8 +371,48 @@ int main(void)
 
 	printf("Board initialised.\n");
 
+	placement_print();
+
+#if USB_AUDIO
+	usbaudio_init(&usb_device, SAMPLE_RATE / PIPELINE_DECIMATION, "STM32F746G Discovery Chirp");
+	if (!usb_init())
+		printf("USB initialisation failed.\n");
+#endif
+
+#if USE_XIP
+	printf("Log store disabled, the QSPI flash holds code.\n");
+#else
+	// The log kept in the QSPI flash, read before anything is logged.
+	const fieldlog_config_t log_config = {
+		.flash = &qspi_log_flash,
+		.sample_rate = SAMPLE_RATE,
+		.recorded_count = capture_count,
+		.replay = capture_replay,
+	};
+	if (qspi_init())
+		fieldlog_init(&log_config);
+#endif
+
+#if LOG_DUMP
+	fieldlog_dump();
+#endif
+
 	setup(SAMPLE_RATE);
 
+	const pipeline_config_t config = {
+		.record_buffer = short_record_buffer,
+		.play_buffer = short_play_buffer,
+		.float_buffer = float_buffer,
+#if USB_AUDIO
+		.loop = loop_streamed,
+#else
+		.loop = loop,
+#endif
+		.can_skip = can_skip,
+		.hal = &pipeline_hal,
+	};
+	pipeline_init(&config);
+
 	if (!init_audio())
 	{
 		printf("Audio initialisation failed.\n");
@@ -350,9 +421,29 @@ int main(void)
 
 	printf("Audio initialised.\n");
 
+	idle_init(FLOAT_BUFFER_SIZE, SAMPLE_RATE);
+
 	while (true)
 	{
-		process_audio();
+		pipeline_process();
+
+		touch_process();
+
+		payload_process();
+
+		fieldlog_process();
+
+#if USB_AUDIO
+		usbaudio_process();
+#endif
+
+		if (button_pressed)
+		{
+			button_pressed = false;
+			button_user_event();
+		}
+
+		wait_for_event();
 	}
 
 	return 0;
@@ -389,7 +480,9 @@ void SystemClock_Config(void)
 	RCC_OscInitStruct.PLL.PLLM = 25;
 	RCC_OscInitStruct.PLL.PLLN = 400;
 	RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-	RCC_OscInitStruct.PLL.PLLQ = 8;
+	// 44.4MHz for the RNG, which must not exceed 48MHz. With USB_AUDIO, the RNG
+	// and the USB take 48MHz from the PLLSAI instead, see `usb_init_clock()`.
+	RCC_OscInitStruct.PLL.PLLQ = 9;
 	ret = HAL_RCC_OscConfig(&RCC_OscInitStruct);
 	if(ret != HAL_OK)
 		error_handler(__func__, __FILE__, __LINE__);
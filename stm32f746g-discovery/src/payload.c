@@ -0,0 +1,284 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file payload.c
+ *
+ *  @brief Payloads sent from a static buffer rather than allocated by
+ *  `chirp_sdk_random_payload()` and freed after every send. The SDK copies
+ *  the payload when it is sent, the buffer is reused straight away.
+ *
+ *  Test payloads are drawn from the hardware RNG, which gives a 32 bits word
+ *  every 40 periods of its clock, the 48MHz domain, in about a microsecond.
+ *
+ *  The load generator sends payloads of the longest length back to back, the
+ *  next one as soon as the SDK is done with the previous one, and prints the
+ *  throughput once done.
+ *
+ *  While playing, payloads sent before are played from the waveform cache
+ *  rather than synthesised again by the SDK, see waveform.c. The callbacks of
+ *  the application are then called from here, as the SDK would.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "main.h"
+
+#include "payload.h"
+#include "pipeline.h"
+#include "waveform.h"
+
+static RNG_HandleTypeDef rng;
+static chirp_sdk_t *chirp = NULL;
+
+static uint8_t send_buffer[PAYLOAD_MAX_LENGTH];
+
+// Payload being played from the cache, and what the cached audio depends on.
+static chirp_sdk_callback_set_t callbacks;
+static uint8_t cached_payload[PAYLOAD_MAX_LENGTH];
+static size_t cached_length = 0;
+static float cached_volume = 0.0f;
+static uint32_t cached_sample_rate = 0;
+
+// Load generator.
+static uint32_t load_remaining = 0;
+static uint32_t load_sent = 0;
+static uint32_t load_bytes = 0;
+static uint32_t load_start = 0;
+static bool load_running = false;
+
+static size_t max_length(void)
+{
+	size_t length = chirp_sdk_get_max_payload_length(chirp);
+
+	return length < PAYLOAD_MAX_LENGTH ? length : PAYLOAD_MAX_LENGTH;
+}
+
+/*
+ * Forget the cached audio if the volume or the output sample rate changed
+ * since it was synthesised.
+ */
+static void check_cache(void)
+{
+	float volume = chirp_sdk_get_volume(chirp);
+	uint32_t sample_rate = chirp_sdk_get_output_sample_rate(chirp);
+
+	if (volume != cached_volume || sample_rate != cached_sample_rate)
+	{
+		waveform_invalidate();
+		cached_volume = volume;
+		cached_sample_rate = sample_rate;
+	}
+}
+
+static uint32_t random_word(void)
+{
+	uint32_t word = 0;
+
+	// Only fails on a seed or clock error, which the next call recovers from.
+	while (HAL_RNG_GenerateRandomNumber(&rng, &word) != HAL_OK)
+		;
+
+	return word;
+}
+
+/*
+ * Start the RNG. `sdk` gives the longest payload and sends them.
+ */
+bool payload_init(chirp_sdk_t *sdk)
+{
+	chirp = sdk;
+
+	__HAL_RCC_RNG_CLK_ENABLE();
+
+	rng.Instance = RNG;
+	if (HAL_RNG_Init(&rng) != HAL_OK)
+	{
+		printf("RNG initialisation failed.\n");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Called by the application once its callbacks are set, so that a payload
+ * played from the cache reaches them too.
+ */
+void payload_set_callbacks(chirp_sdk_callback_set_t payload_callbacks)
+{
+	callbacks = payload_callbacks;
+}
+
+/*
+ * Set the config of the SDK, which changes the audio of every payload.
+ */
+chirp_sdk_error_code_t payload_set_config(const char *config)
+{
+	waveform_invalidate();
+
+	return chirp_sdk_set_config(chirp, config);
+}
+
+/*
+ * Fill `buffer` with `length` random bytes, or with a random number of them
+ * up to the longest payload if `length` is 0. Returns the length filled.
+ */
+size_t payload_random(uint8_t *buffer, size_t length)
+{
+	if (length == 0)
+		length = 1 + random_word() % max_length();
+
+	for (size_t i = 0; i < length; i += sizeof(uint32_t))
+	{
+		uint32_t word = random_word();
+		size_t count = length - i < sizeof(word) ? length - i : sizeof(word);
+		memcpy(&buffer[i], &word, count);
+	}
+
+	return length;
+}
+
+/*
+ * Send `length` bytes of `data`, which can be reused as soon as this
+ * returns. The payload is checked by the SDK first. Returns
+ * `CHIRP_SDK_ALREADY_SENDING` while a payload is played from the cache.
+ */
+chirp_sdk_error_code_t payload_send(const uint8_t *data, size_t length)
+{
+	if (length > PAYLOAD_MAX_LENGTH)
+		return CHIRP_SDK_PAYLOAD_TOO_LONG;
+
+	// `chirp_sdk_send()` takes a mutable buffer, the data is not modified
+	// but may be in flash.
+	if (data != send_buffer)
+		memcpy(send_buffer, data, length);
+
+	if (cached_length > 0)
+		return CHIRP_SDK_ALREADY_SENDING;
+
+	chirp_sdk_error_code_t error = chirp_sdk_is_valid(chirp, send_buffer, length);
+	if (error != CHIRP_SDK_OK)
+		return error;
+
+	// The pipeline only calls the SDK to synthesise audio while playing.
+	if (pipeline_get_mode() != PIPELINE_PLAYING)
+		return chirp_sdk_send(chirp, send_buffer, length);
+
+	check_cache();
+
+	if (chirp_sdk_get_state(chirp) == CHIRP_SDK_STATE_RUNNING && waveform_play(send_buffer, length))
+	{
+		memcpy(cached_payload, send_buffer, length);
+		cached_length = length;
+
+		if (callbacks.on_sending)
+			callbacks.on_sending(chirp, cached_payload, cached_length, 0);
+		return CHIRP_SDK_OK;
+	}
+
+	error = chirp_sdk_send(chirp, send_buffer, length);
+	if (error == CHIRP_SDK_OK)
+		waveform_record(send_buffer, length);
+
+	return error;
+}
+
+/*
+ * Once a payload played from the cache is over, give it to `on_sent` as the
+ * SDK would.
+ */
+static void cached_sent(void)
+{
+	size_t length = cached_length;
+
+	cached_length = 0;
+
+	if (callbacks.on_sent)
+		callbacks.on_sent(chirp, cached_payload, length, 0);
+}
+
+/*
+ * Send a random payload of `length` bytes, of random length if 0.
+ */
+chirp_sdk_error_code_t payload_send_random(size_t length)
+{
+	if (length > max_length())
+		return CHIRP_SDK_PAYLOAD_TOO_LONG;
+
+	length = payload_random(send_buffer, length);
+
+	return payload_send(send_buffer, length);
+}
+
+/*
+ * Send `count` payloads back to back, from `payload_process()`.
+ */
+void payload_load_start(uint32_t count)
+{
+	load_remaining = count;
+	load_sent = 0;
+	load_bytes = 0;
+	load_start = HAL_GetTick();
+	load_running = count > 0;
+
+	printf("Load: sending %lu payloads of %u bytes.\n", count, max_length());
+}
+
+/*
+ * Print how well the waveform cache did.
+ */
+void payload_print_cache(void)
+{
+	waveform_stats_t stats;
+	waveform_get_stats(&stats);
+
+	printf("Waveform cache: %lu hits, %lu misses, %lu evictions, %lu payloads in %lu of %lu bytes.\n",
+			stats.hits, stats.misses, stats.evictions, stats.entries, stats.used_bytes, stats.size_bytes);
+}
+
+/*
+ * Called from the main loop, calls `on_sent` once a payload played from the
+ * cache is over, and sends the next payload of the load generator once the
+ * SDK is idle again. The SDK is not called from its callbacks.
+ */
+void payload_process(void)
+{
+	if (pipeline_get_mode() != PIPELINE_PLAYING)
+		waveform_stop();
+
+	if (cached_length > 0)
+	{
+		if (waveform_playing())
+			return;
+		cached_sent();
+	}
+
+	if (!load_running || chirp_sdk_get_state(chirp) != CHIRP_SDK_STATE_RUNNING)
+		return;
+
+	if (load_remaining == 0)
+	{
+		uint32_t elapsed = HAL_GetTick() - load_start;
+		printf("Load: %lu payloads, %lu bytes in %lu ms, %lu bit/s.\n", load_sent, load_bytes, elapsed,
+				elapsed ? (uint32_t) ((uint64_t) load_bytes * 8000 / elapsed) : 0);
+		payload_print_cache();
+		load_running = false;
+		return;
+	}
+
+	size_t length = max_length();
+	chirp_sdk_error_code_t error = payload_send_random(length);
+	if (error != CHIRP_SDK_OK)
+	{
+		printf("Load: %s, stopped.\n", chirp_sdk_error_code_to_string(error));
+		load_running = false;
+		return;
+	}
+
+	load_remaining--;
+	load_sent++;
+	load_bytes += length;
+}
@@ -0,0 +1,98 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file placement.c
+ *
+ *  @brief Memory placement of the hot code and data. The internal memories of
+ *  the STM32F746 are split by the linker script into:
+ *
+ *  - ITCM (16K), for the functions run every audio period, executed without
+ *    going through the flash accelerator or the instruction cache,
+ *  - DTCM (64K), for the data accessed every audio period, with no wait state
+ *    and no cache to thrash,
+ *  - SRAM1 (240K), for everything else, the heap and the stack,
+ *  - SRAM2 (16K), for the buffers read and written by the DMA.
+ *
+ *  The startup code copies and zeroes the ITCM and DTCM sections. SRAM2 is
+ *  made non cacheable with the MPU so the CPU and the DMA always see the same
+ *  audio samples while the D-cache stays enabled for everything else.
+ *
+ *  Built with `make XIP=1`, the code only run at the start or to draw on the
+ *  screen is executed in place from the QSPI flash, through the caches, which
+ *  leaves the internal flash to the rest. The MPU then only lets the core
+ *  reach the 16MB of the flash, anything above would stall the bus.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+
+#include "main.h"
+#include "placement.h"
+
+// Set by the linker script.
+extern uint32_t _sitcm, _eitcm;
+#if USE_XIP
+extern uint32_t _sqspi, _eqspi;
+#endif
+
+/*
+ * Configure the MPU. Must be called before the caches are enabled.
+ */
+void placement_init(void)
+{
+	MPU_Region_InitTypeDef region = {0};
+
+	HAL_MPU_Disable();
+
+	region.Enable = MPU_REGION_ENABLE;
+	region.Number = MPU_REGION_NUMBER0;
+	region.BaseAddress = SRAM2_BASE;
+	region.Size = MPU_REGION_SIZE_16KB;
+	region.AccessPermission = MPU_REGION_FULL_ACCESS;
+	region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+	region.TypeExtField = MPU_TEX_LEVEL1;
+	region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+	region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+	region.IsShareable = MPU_ACCESS_SHAREABLE;
+	region.SubRegionDisable = 0x00;
+	HAL_MPU_ConfigRegion(&region);
+
+#if USE_XIP
+	// The whole QSPI range, out of reach.
+	region.Number = MPU_REGION_NUMBER1;
+	region.BaseAddress = QSPI_BASE;
+	region.Size = MPU_REGION_SIZE_256MB;
+	region.AccessPermission = MPU_REGION_NO_ACCESS;
+	region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+	region.TypeExtField = MPU_TEX_LEVEL0;
+	region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+	region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+	region.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+	HAL_MPU_ConfigRegion(&region);
+
+	// The flash itself, read only and cached.
+	region.Number = MPU_REGION_NUMBER2;
+	region.Size = MPU_REGION_SIZE_16MB;
+	region.AccessPermission = MPU_REGION_PRIV_RO_URO;
+	region.DisableExec = MPU_INSTRUCTION_ACCESS_ENABLE;
+	region.IsCacheable = MPU_ACCESS_CACHEABLE;
+	HAL_MPU_ConfigRegion(&region);
+#endif
+
+	HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+}
+
+/*
+ * Print how much code was moved out of the internal flash, to go with the CPU
+ * load lines when comparing builds. `make placement` lists the functions.
+ */
+void placement_print(void)
+{
+	printf("Placement: %lu bytes in ITCM", (unsigned long) ((uint8_t *) &_eitcm - (uint8_t *) &_sitcm));
+#if USE_XIP
+	printf(", %lu bytes in QSPI flash", (unsigned long) ((uint8_t *) &_eqspi - (uint8_t *) &_sqspi));
+#endif
+	printf(".\n");
+}
@@ -0,0 +1,38 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file screen.c
+ *
+ *  @brief Display of the pre-rendered screens with two DMA2D transfers: a
+ *  register to memory fill of the background, then a memory to memory
+ *  conversion of the alpha mask of the banner into the frame buffer. Both
+ *  are started without waiting, the second one by the interrupt ending the
+ *  first, and the CPU never touches the pixels.
+ *
+ *  The pixels the mask leaves transparent show the black background color
+ *  of the LTDC, which is the banner, and the text blends into it.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+#include "lcd_dma2d.h"
+#include "screen.h"
+
+/*
+ * Draw `screen` to the frame buffer. The transfers are left running, see
+ * `lcd_dma2d_wait()`.
+ */
+void screen_show(const screen_t *screen)
+{
+	uint32_t *frame_buffer = (uint32_t *) LCD_FB_START_ADDRESS;
+	uint32_t top = screen->height - screen->banner_height;
+
+	if (screen->width != BSP_LCD_GetXSize() || screen->height != BSP_LCD_GetYSize())
+		error_handler(__func__, __FILE__, __LINE__);
+
+	lcd_dma2d_fill(frame_buffer, screen->width, top, 0, screen->background);
+	lcd_dma2d_mask(screen->banner, frame_buffer + top * screen->width, screen->width, screen->banner_height,
+			screen->background);
+}
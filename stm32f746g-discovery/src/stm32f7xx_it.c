@@ -1,6 +1,8 @@
 #include "stm32f7xx_it.h"
 #include "stm32746g_discovery.h"
 #include "stm32746g_discovery_audio.h"
+#include "lcd_dma2d.h"
+#include "usb.h"
 
 /* SAI handler declared in "stm32746g_discovery_audio.c" file */
 extern SAI_HandleTypeDef haudio_out_sai;
@@ -8,6 +10,9 @@ extern SAI_HandleTypeDef haudio_out_sai;
 /* SAI handler declared in "stm32746g_discovery_audio.c" file */
 extern SAI_HandleTypeDef haudio_in_sai;
 
+/* UART handler declared in "uart.c" file */
+extern UART_HandleTypeDef huart1;
+
 void NMI_Handler(void)
 {
 }
@@ -83,3 +88,20 @@ void AUDIO_OUT_SAIx_DMAx_IRQHandler(void)
 {
 	HAL_DMA_IRQHandler(haudio_out_sai.hdmatx);
 }
+
+void USART1_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart1);
+}
+
+void DMA2D_IRQHandler(void)
+{
+	HAL_DMA2D_IRQHandler(&lcd_dma2d_handle);
+}
+
+#if USB_AUDIO
+void OTG_FS_IRQHandler(void)
+{
+	HAL_PCD_IRQHandler(&usb_pcd);
+}
+#endif
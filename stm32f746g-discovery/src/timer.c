@@ -0,0 +1,57 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file timer.c
+ *
+ *  @brief Free-running microsecond counter on TIM2, one of the 32 bits
+ *  timers, which stamps the events of eventlog.c. Unlike the cycle counter,
+ *  it does not follow the core clock changed by the governor: TIM2 is
+ *  clocked from APB1, which the governor keeps at the same frequency. It
+ *  wraps every 71 minutes.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include "main.h"
+
+#include "pipeline.h"
+#include "timer.h"
+
+static TIM_HandleTypeDef timer;
+
+bool timer_init(void)
+{
+	RCC_ClkInitTypeDef clock;
+	uint32_t latency;
+	uint32_t frequency = HAL_RCC_GetPCLK1Freq();
+
+	// The timers of APB1 run at twice its clock when it is divided.
+	HAL_RCC_GetClockConfig(&clock, &latency);
+	if (clock.APB1CLKDivider != RCC_HCLK_DIV1)
+		frequency *= 2;
+
+	__HAL_RCC_TIM2_CLK_ENABLE();
+
+	timer.Instance = TIM2;
+	timer.Init.Prescaler = frequency / 1000000 - 1;
+	timer.Init.CounterMode = TIM_COUNTERMODE_UP;
+	timer.Init.Period = 0xFFFFFFFF;
+	timer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	timer.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+	if (HAL_TIM_Base_Init(&timer) != HAL_OK)
+		return false;
+
+	return HAL_TIM_Base_Start(&timer) == HAL_OK;
+}
+
+uint32_t timer_micros(void)
+{
+	return TIM2->CNT;
+}
+
+const eventlog_clock_t timer_clock = {
+	.micros = timer_micros,
+	.position = pipeline_position,
+};
@@ -0,0 +1,103 @@
+/**-----------------------------------------------------------------------------
+ *
+ *  @file touch.c
+ *
+ *  @brief Touch screen events handling. The touch screen interrupt only
+ *  timestamps the event and pushes it into a queue. The queue is drained from
+ *  the main loop where events close to each other are batched into a single
+ *  gesture, and `on_screen_touch()` is called once per gesture. This way the
+ *  application, and thus the SDK, is never reached from an interrupt.
+ *
+ *  The controller raises its interrupt line for every report while the
+ *  screen is touched, so the edge itself is the event and no register needs
+ *  to be read over I2C.
+ *
+ *  Copyright © 2011-2019, Asio Ltd.
+ *  All rights reserved.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+
+#include "main.h"
+#include "touch.h"
+
+// Must be a power of two.
+#define TOUCH_QUEUE_SIZE	16
+
+// Events less than 100 ms apart belong to the same gesture.
+#define TOUCH_GESTURE_GAP	100
+
+// Minimum time between the start of two gestures, 1000 ms = 1 s.
+#define TOUCH_DEBOUNCE		1000
+
+/*
+ * Single producer (interrupt), single consumer (main loop) queue of event
+ * timestamps. Indexes are free running and wrapped on access.
+ */
+static volatile uint32_t queue[TOUCH_QUEUE_SIZE];
+static volatile uint32_t queue_head = 0;
+static volatile uint32_t queue_tail = 0;
+
+static bool gesture_active = false;
+static uint32_t gesture_last = 0;
+
+static bool touched = false;
+static uint32_t touch_start = 0;
+
+/*
+ * Called from the touch screen interrupt. If the queue is full the event is
+ * dropped, which is harmless as it would have been batched anyway.
+ */
+void touch_interrupt(void)
+{
+	uint32_t head = queue_head;
+
+	if (head - queue_tail == TOUCH_QUEUE_SIZE)
+		return;
+
+	queue[head & (TOUCH_QUEUE_SIZE - 1)] = HAL_GetTick();
+	__DMB();
+	queue_head = head + 1;
+}
+
+/*
+ * Called from the main loop. Starts a gesture on the first event following a
+ * quiet period and reports it straight away, the following events only
+ * extend the gesture.
+ */
+void touch_process(void)
+{
+	while (queue_tail != queue_head)
+	{
+		uint32_t tick = queue[queue_tail & (TOUCH_QUEUE_SIZE - 1)];
+		queue_tail++;
+
+		if (gesture_active && tick - gesture_last <= TOUCH_GESTURE_GAP)
+		{
+			gesture_last = tick;
+			continue;
+		}
+
+		gesture_active = true;
+		gesture_last = tick;
+
+		if (!touched || tick - touch_start > TOUCH_DEBOUNCE)
+		{
+			touched = true;
+			touch_start = tick;
+			on_screen_touch();
+		}
+	}
+
+	if (gesture_active && HAL_GetTick() - gesture_last > TOUCH_GESTURE_GAP)
+		gesture_active = false;
+}
+
+/*
+ * Whether some events are waiting to be processed.
+ */
+bool touch_pending(void)
+{
+	return queue_tail != queue_head;
+}
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Pre-render the full screen images displayed for each state of the examples
+and write them in a C source file, as a background color and the alpha mask
+of a banner.
+
+Usage: make_screens.py WIDTH HEIGHT FONT > src/screen_data.c
+
+FONT is one of the fonts of the BSP, Utilities/Fonts/font24.c, in which the
+name of the state is written on a banner along the bottom of the screen. The
+console text is drawn above the banner, on the background.
+
+The mask has 4 bits of alpha a pixel, the first pixel of each byte in its low
+nibble, as the DMA2D reads A4 data. screen.c fills the background with one
+DMA2D transfer and converts the mask into the frame buffer with another one,
+in the background color: the transparent pixels show the black background of
+the LTDC, which makes the banner.
+"""
+
+import re
+import sys
+
+# Colors matching the LCD_COLOR_* definitions of the BSP.
+WHITE = 0xFFFFFFFF
+BLUE = 0xFF0000FF
+GREEN = 0xFF00FF00
+RED = 0xFFFF0000
+YELLOW = 0xFFFFFF00
+
+# Height of the banner, its text written in the background color.
+BANNER_HEIGHT = 32
+
+# Name of the screen, its background color and the text of its banner.
+SCREENS = [
+    ("listening", WHITE, "Listening"),
+    ("receiving", BLUE, "Receiving"),
+    ("received", GREEN, "Received"),
+    ("failed", RED, "Failed"),
+    ("sending", YELLOW, "Sending"),
+    ("sent", WHITE, "Sent"),
+    ("calibrating", WHITE, "Calibrating"),
+]
+
+
+class Font:
+    """
+    Font of the BSP: a table of glyphs from ' ' to '~', each of `height` rows
+    of `width` pixels, the rows padded to whole bytes with the first pixel in
+    the most significant bit.
+    """
+
+    def __init__(self, path):
+        with open(path) as source:
+            text = re.sub(r"//[^\n]*", "", source.read())
+
+        self.width = int(re.search(r"(\d+),\s*/\* Width \*/", text).group(1))
+        self.height = int(re.search(r"(\d+),\s*/\* Height \*/", text).group(1))
+        table = re.search(r"_Table\s*\[\]\s*=\s*\{(.*?)\};", text, re.S).group(1)
+        self.data = [int(byte, 16) for byte in re.findall(r"0x[0-9A-Fa-f]{2}", table)]
+        self.row_size = (self.width + 7) // 8
+
+    def pixel(self, char, x, y):
+        row = ((ord(char) - ord(" ")) * self.height + y) * self.row_size
+        byte = self.data[row + x // 8]
+        return bool(byte & (0x80 >> (x % 8)))
+
+
+def render(width, title, font):
+    """
+    Alpha of every pixel of the banner, opaque in the strokes of the text.
+    """
+    alphas = [0] * (width * BANNER_HEIGHT)
+
+    left = (width - len(title) * font.width) // 2
+    top = (BANNER_HEIGHT - font.height) // 2
+    for y in range(font.height):
+        for i, char in enumerate(title):
+            for x in range(font.width):
+                if font.pixel(char, x, y):
+                    alphas[(top + y) * width + left + i * font.width + x] = 0xF
+
+    return alphas
+
+
+def pack(alphas):
+    return [alphas[i] | alphas[i + 1] << 4 for i in range(0, len(alphas), 2)]
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__.strip())
+
+    width = int(sys.argv[1])
+    height = int(sys.argv[2])
+    font = Font(sys.argv[3])
+
+    # Whole bytes on each line of the mask.
+    if width % 2:
+        sys.exit("The width must be even.")
+
+    out = sys.stdout
+    out.write("/*\n * Generated by tools/make_screens.py for a %dx%d screen, do not edit.\n */\n\n" % (width, height))
+    out.write('#include "screen.h"\n')
+
+    # Screens with the same text share their mask.
+    masks = {}
+    for name, background, title in SCREENS:
+        if title not in masks:
+            masks[title] = name
+            data = pack(render(width, title, font))
+            out.write("\nstatic const uint8_t %s_banner[] = {\n" % name)
+            for i in range(0, len(data), 16):
+                out.write("\t%s,\n" % ", ".join("0x%02X" % byte for byte in data[i:i + 16]))
+            out.write("};\n")
+
+        out.write("\nconst screen_t screen_%s = {\n" % name)
+        out.write("\t.width = %d,\n\t.height = %d,\n" % (width, height))
+        out.write("\t.background = 0x%08X,\n" % background)
+        out.write("\t.banner_height = %d,\n" % BANNER_HEIGHT)
+        out.write("\t.banner = %s_banner,\n};\n" % masks[title])
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""
+List the functions and data of a firmware by the memory they were placed in,
+to check what the section attributes and the linker scripts moved to the
+ITCM, the DTCM, SRAM2 or the QSPI flash.
+
+Usage: placement_report.py [--objdump OBJDUMP] [--all] FIRMWARE.elf
+
+Every symbol of the placed sections is listed, largest first. The internal
+flash and SRAM1 only get a total unless --all is given. The cycles saved are
+not known here, compare the CPU load lines printed by both builds.
+"""
+
+import argparse
+import subprocess
+import sys
+
+# Output sections and what they are, in the order printed. The ones not
+# listed are summed up under "other".
+SECTIONS = [
+    (".itcm_text", "ITCM, code"),
+    (".qspi_text", "QSPI flash, code"),
+    (".qspi_rodata", "QSPI flash, constants"),
+    (".dtcm_data", "DTCM, data"),
+    (".dtcm_bss", "DTCM, zeroed data"),
+    (".dma_buffer", "SRAM2, DMA buffers"),
+    (".text", "internal flash, code"),
+    (".rodata", "internal flash, constants"),
+    (".data", "SRAM1, data"),
+    (".bss", "SRAM1, zeroed data"),
+]
+
+# Sections only summed up without --all.
+LARGE = {".text", ".rodata", ".data", ".bss"}
+
+
+def read_symbols(objdump, elf):
+    """Return {section: [(size, name)]} for the functions and objects."""
+    output = subprocess.run([objdump, "-t", elf], check=True, capture_output=True, text=True).stdout
+
+    symbols = {}
+    for line in output.splitlines():
+        if "\t" not in line:
+            continue
+
+        left, right = line.split("\t", 1)
+        fields = left.split()
+        if len(fields) < 3 or fields[-2] not in ("F", "O"):
+            continue
+
+        size, _, name = right.partition(" ")
+        symbols.setdefault(fields[-1], []).append((int(size, 16), name.strip()))
+
+    return symbols
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--objdump", default="arm-none-eabi-objdump")
+    parser.add_argument("--all", action="store_true", help="also list the internal flash and SRAM1")
+    parser.add_argument("elf")
+    args = parser.parse_args()
+
+    symbols = read_symbols(args.objdump, args.elf)
+
+    for section, description in SECTIONS:
+        entries = sorted(symbols.pop(section, []), reverse=True)
+        if not entries:
+            continue
+
+        total = sum(size for size, _ in entries)
+        print(f"{section} ({description}): {total} bytes in {len(entries)} symbols")
+
+        if section in LARGE and not args.all:
+            continue
+
+        for size, name in entries:
+            print(f"    {size:8} {name}")
+
+    other = sum(size for entries in symbols.values() for size, _ in entries)
+    if other:
+        print(f"other: {other} bytes in {sum(len(entries) for entries in symbols.values())} symbols")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
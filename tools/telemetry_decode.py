@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+"""
+Decode the binary telemetry of boards built with `make BINARY_TELEMETRY=1`,
+read from any number of serial ports at once, or from files they were
+recorded to.
+
+Usage: telemetry_decode.py [--baud BAUD] [--quiet] [--interval SECONDS] PORT...
+
+Every record is printed on a line starting with the name of its port, along
+with the text lines the boards still print. With --interval, the counters of
+every port and their totals are printed every that many seconds, and always
+once all the ports are closed or on Ctrl-C. Only needs Python 3 on Linux.
+
+A frame is sent between two zero bytes, COBS encoded. Decoded, it is an
+8 bytes header, type, body length, sequence number and time in milliseconds,
+then the body padded to 32 bits words, then the CRC-32 of the little endian
+words as the CRC unit of the board computes it. See common/src/telemetry.c.
+"""
+
+import argparse
+import os
+import selectors
+import struct
+import sys
+import termios
+import time
+import tty
+
+HEADER = struct.Struct("<BBHI")
+
+STATES = ["not created", "stopped", "running", "sending", "receiving"]
+
+BOOT, STATE, SENDING, SENT, RECEIVING, RECEIVED, LOAD, CLOCK, MEMORY = range(1, 10)
+
+NAMES = {
+    BOOT: "boot",
+    STATE: "state",
+    SENDING: "sending",
+    SENT: "sent",
+    RECEIVING: "receiving",
+    RECEIVED: "received",
+    LOAD: "load",
+    CLOCK: "clock",
+    MEMORY: "memory",
+}
+
+# Counters kept for every port, in the order printed.
+COUNTERS = ["frames", "bad", "lost", "boots", "sent", "received", "failed", "dropped"]
+
+
+def crc_table():
+    table = []
+    for byte in range(256):
+        crc = byte << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else crc << 1
+        table.append(crc & 0xFFFFFFFF)
+    return table
+
+
+CRC_TABLE = crc_table()
+
+
+def crc32(words):
+    """CRC-32, polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection,
+    fed a word at a time from its most significant bit."""
+    crc = 0xFFFFFFFF
+    for word in words:
+        for shift in (24, 16, 8, 0):
+            crc = ((crc << 8) & 0xFFFFFFFF) ^ CRC_TABLE[(crc >> 24) ^ ((word >> shift) & 0xFF)]
+    return crc
+
+
+def cobs_decode(data):
+    """Return the bytes encoded, or None if `data` is not COBS."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def check_frame(data):
+    """Return (type, sequence, time, body) of a decoded frame, or None."""
+    if len(data) < HEADER.size + 4 or len(data) % 4:
+        return None
+
+    words = struct.unpack(f"<{len(data) // 4}I", data)
+    if crc32(words[:-1]) != words[-1]:
+        return None
+
+    kind, length, sequence, millis = HEADER.unpack_from(data)
+    if HEADER.size + length > len(data) - 4:
+        return None
+
+    return kind, sequence, millis, data[HEADER.size:HEADER.size + length]
+
+
+def describe(kind, body):
+    """Fields of a record as text."""
+    if kind == BOOT:
+        version, stack = struct.unpack_from("<BI", body)
+        return f"version {version}, stack {stack} bytes"
+
+    if kind == STATE:
+        old, new = body[0], body[1]
+        name = lambda state: STATES[state] if state < len(STATES) else str(state)
+        return f"{name(old)} -> {name(new)}"
+
+    if kind in (SENDING, SENT, RECEIVING, RECEIVED):
+        channel, length = body[0], body[1]
+        payload = body[2:].hex()
+        if kind == RECEIVED and length == 0:
+            return f"channel {channel}, failed"
+        if len(body) - 2 < length:
+            payload += "..."
+        return f"channel {channel}, {length} bytes {payload}".rstrip()
+
+    if kind == LOAD:
+        average, peak, peak_cycles, period_cycles = struct.unpack_from("<HHII", body)
+        return (f"{average / 100:.1f}% average, {peak / 100:.1f}% peak "
+                f"({peak_cycles} of {period_cycles} cycles per period)")
+
+    if kind == CLOCK:
+        frequency, running, sending, receiving = struct.unpack_from("<IIII", body)
+        return (f"{frequency // 1000000} MHz (peak cycles per period: running {running}, "
+                f"sending {sending}, receiving {receiving})")
+
+    if kind == MEMORY:
+        fields = struct.unpack_from("<IIIIIIIiiI", body)
+        names = ["record", "stack_peak", "stack_size", "sbrk_peak", "arena_used", "arena_peak",
+                 "arena_size", "sdk_heap", "sdk_heap_peak", "dropped"]
+        return ", ".join(f"{name} {value}" for name, value in zip(names, fields))
+
+    return body.hex()
+
+
+class Port:
+    """The decoder of the stream of one port."""
+
+    def __init__(self, path, quiet):
+        self.name = os.path.basename(path)
+        self.quiet = quiet
+        self.counters = dict.fromkeys(COUNTERS, 0)
+        self.sequence = None
+        self.in_frame = False
+        self.pending = bytearray()
+
+    def print(self, text):
+        if not self.quiet:
+            print(f"{self.name} {text}", flush=True)
+
+    def feed(self, data):
+        for byte in data:
+            if byte != 0:
+                self.pending.append(byte)
+                if not self.in_frame and byte == ord("\n"):
+                    self.flush_text()
+                continue
+
+            if not self.in_frame:
+                # Leading delimiter of a frame.
+                self.flush_text()
+                self.in_frame = True
+            elif not self.pending:
+                # Two delimiters in a row: out of step, this one leads.
+                pass
+            else:
+                self.frame(bytes(self.pending))
+                self.pending.clear()
+                self.in_frame = False
+
+    def flush_text(self):
+        text = self.pending.decode("utf-8", "replace").strip()
+        self.pending.clear()
+        if text:
+            self.print(f"text {text}")
+
+    def frame(self, encoded):
+        data = cobs_decode(encoded)
+        frame = check_frame(data) if data is not None else None
+        if frame is None:
+            self.counters["bad"] += 1
+            return
+
+        kind, sequence, millis, body = frame
+        self.counters["frames"] += 1
+
+        if kind == BOOT:
+            self.counters["boots"] += 1
+        elif self.sequence is not None:
+            self.counters["lost"] += (sequence - self.sequence - 1) & 0xFFFF
+        self.sequence = sequence
+
+        if kind == SENT:
+            self.counters["sent"] += 1
+        elif kind == RECEIVED:
+            self.counters["received" if body[1] else "failed"] += 1
+        elif kind == MEMORY:
+            self.counters["dropped"] = struct.unpack_from("<I", body, 36)[0]
+
+        self.print(f"{millis} {sequence} {NAMES.get(kind, kind)} {describe(kind, body)}")
+
+
+def open_port(path, baud):
+    """Open a serial port raw at `baud`, or a file as it is."""
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY | os.O_NONBLOCK)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attributes = termios.tcgetattr(fd)
+        speed = getattr(termios, f"B{baud}")
+        attributes[4] = attributes[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attributes)
+    return fd
+
+
+def print_summary(ports):
+    width = max(len(port.name) for port in ports)
+    print(f"{'port':{width}} " + " ".join(f"{name:>9}" for name in COUNTERS))
+    for port in ports:
+        print(f"{port.name:{width}} " + " ".join(f"{port.counters[name]:9}" for name in COUNTERS))
+    if len(ports) > 1:
+        totals = {name: sum(port.counters[name] for port in ports) for name in COUNTERS}
+        print(f"{'total':{width}} " + " ".join(f"{totals[name]:9}" for name in COUNTERS))
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--quiet", action="store_true", help="only print the counters")
+    parser.add_argument("--interval", type=float, help="print the counters every that many seconds")
+    parser.add_argument("ports", nargs="+")
+    args = parser.parse_args()
+
+    # poll, unlike epoll, also takes the files recorded.
+    selector = selectors.PollSelector()
+    ports = []
+    for path in args.ports:
+        port = Port(path, args.quiet)
+        ports.append(port)
+        selector.register(open_port(path, args.baud), selectors.EVENT_READ, port)
+
+    next_summary = time.monotonic() + args.interval if args.interval else None
+
+    try:
+        while selector.get_map():
+            timeout = max(0, next_summary - time.monotonic()) if next_summary else None
+            for key, _ in selector.select(timeout):
+                data = os.read(key.fd, 4096)
+                if data:
+                    key.data.feed(data)
+                else:
+                    selector.unregister(key.fd)
+                    os.close(key.fd)
+
+            if next_summary and time.monotonic() >= next_summary:
+                print_summary(ports)
+                next_summary += args.interval
+    except KeyboardInterrupt:
+        pass
+
+    print_summary(ports)
+
+
+if __name__ == "__main__":
+    sys.exit(main())